@@ -0,0 +1,55 @@
+#include "alloc_counter.hpp"
+#include <cstdlib>
+#include <new>
+
+#ifdef ALLOC_COUNTER
+
+// Replaces the global (unaligned) operator new/delete with malloc/free plus
+// a thread-local counter, which costs one increment per allocation.
+
+namespace {
+thread_local uint64_t allocations = 0;
+} // namespace
+
+uint64_t threadAllocations() {
+    return allocations;
+}
+
+bool allocationCountingEnabled() {
+    return true;
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+#else
+
+uint64_t threadAllocations() {
+    return 0;
+}
+
+bool allocationCountingEnabled() {
+    return false;
+}
+
+#endif
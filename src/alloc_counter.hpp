@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of global operator new calls made by the calling thread so far.
+// Used by the allocation benchmarks. Plain malloc (e.g. inside libcurl or
+// OpenSSL) is not counted.
+//
+// Counting replaces the global operator new, so it is only compiled in with
+// `make ALLOC_COUNTER=1`; otherwise this always returns 0.
+uint64_t threadAllocations();
+bool allocationCountingEnabled();
@@ -0,0 +1,144 @@
+#include "async_http.hpp"
+#include "http_pool.hpp"
+#include "latency_histogram.hpp"
+#include <iostream>
+
+AsyncHttpClient& AsyncHttpClient::instance() {
+    static AsyncHttpClient client;
+    return client;
+}
+
+AsyncHttpClient::AsyncHttpClient() {
+    // Make sure the pool (and curl_global_init) outlives this client
+    HttpPool::instance();
+    multi_ = curl_multi_init();
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi_, CURLMOPT_MAX_CONCURRENT_STREAMS, 100L);
+    loop_ = std::thread(&AsyncHttpClient::run, this);
+}
+
+AsyncHttpClient::~AsyncHttpClient() {
+    stopping_ = true;
+    curl_multi_wakeup(multi_);
+    if (loop_.joinable()) {
+        loop_.join();
+    }
+    curl_multi_cleanup(multi_);
+}
+
+void AsyncHttpClient::get(const std::string& url, const std::vector<std::string>& headers, Callback callback) {
+    auto* transfer = new Transfer();
+    transfer->url = url;
+    transfer->callback = std::move(callback);
+    transfer->submitted = std::chrono::steady_clock::now();
+    for (const auto& header : headers) {
+        transfer->headers = curl_slist_append(transfer->headers, header.c_str());
+    }
+
+    size_t inFlight = inFlight_.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t seen = maxInFlight_.load(std::memory_order_relaxed);
+    while (inFlight > seen && !maxInFlight_.compare_exchange_weak(seen, inFlight, std::memory_order_relaxed)) {
+    }
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        pending_.push_back(transfer);
+    }
+    curl_multi_wakeup(multi_);
+}
+
+AsyncHttpClient::Stats AsyncHttpClient::stats() const {
+    return {completed_.load(std::memory_order_relaxed), http2_.load(std::memory_order_relaxed),
+            http1_.load(std::memory_order_relaxed), newConnections_.load(std::memory_order_relaxed),
+            inFlight_.load(std::memory_order_relaxed), maxInFlight_.load(std::memory_order_relaxed)};
+}
+
+std::future<HttpResponse> AsyncHttpClient::get(const std::string& url, const std::vector<std::string>& headers) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> future = promise->get_future();
+    get(url, headers, [promise](HttpResponse&& response) {
+        promise->set_value(std::move(response));
+    });
+    return future;
+}
+
+void AsyncHttpClient::startPending() {
+    std::vector<Transfer*> batch;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        batch.swap(pending_);
+    }
+
+    for (Transfer* transfer : batch) {
+        transfer->handle = HttpPool::instance().acquire();
+        if (!transfer->handle) {
+            transfer->response.result = CURLE_FAILED_INIT;
+            transfer->callback(std::move(transfer->response));
+            curl_slist_free_all(transfer->headers);
+            delete transfer;
+            inFlight_.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        prepareGet(transfer->handle, transfer->url, transfer->headers, transfer->response.body);
+        curl_easy_setopt(transfer->handle, CURLOPT_PRIVATE, transfer);
+        curl_multi_add_handle(multi_, transfer->handle);
+        active_.insert(transfer);
+    }
+}
+
+void AsyncHttpClient::finish(CURLMsg* msg) {
+    Transfer* transfer = nullptr;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+    curl_multi_remove_handle(multi_, transfer->handle);
+    active_.erase(transfer);
+
+    transfer->response.result = msg->data.result;
+    if (msg->data.result == CURLE_OK) {
+        long version = 0, connects = 0;
+        curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &transfer->response.status);
+        curl_easy_getinfo(transfer->handle, CURLINFO_HTTP_VERSION, &version);
+        curl_easy_getinfo(transfer->handle, CURLINFO_NUM_CONNECTS, &connects);
+        (version >= CURL_HTTP_VERSION_2_0 ? http2_ : http1_).fetch_add(1, std::memory_order_relaxed);
+        newConnections_.fetch_add(connects, std::memory_order_relaxed);
+        recordStages(transfer->handle, transfer->url);
+        latency(std::string(endpointOf(transfer->url)) + " stream").record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - transfer->submitted).count());
+    }
+    completed_.fetch_add(1, std::memory_order_relaxed);
+    HttpPool::instance().release(transfer->handle);
+    curl_slist_free_all(transfer->headers);
+    inFlight_.fetch_sub(1, std::memory_order_relaxed);
+
+    try {
+        transfer->callback(std::move(transfer->response));
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Async HTTP callback failed: " << e.what() << std::endl;
+    }
+    delete transfer;
+}
+
+void AsyncHttpClient::run() {
+    while (!stopping_) {
+        startPending();
+
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+            if (msg->msg == CURLMSG_DONE) finish(msg);
+        }
+
+        // Sleeps until socket activity, a curl timeout or curl_multi_wakeup()
+        curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+    }
+
+    // Fail whatever is left so no future is abandoned
+    startPending();
+    std::vector<Transfer*> left(active_.begin(), active_.end());
+    for (Transfer* transfer : left) {
+        CURLMsg msg{};
+        msg.easy_handle = transfer->handle;
+        msg.data.result = CURLE_ABORTED_BY_CALLBACK;
+        finish(&msg);
+    }
+}
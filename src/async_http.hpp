@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+struct HttpResponse {
+    CURLcode result = CURLE_OK;
+    long status = 0;
+    std::string body;
+};
+
+// Non-blocking GETs driven by a single curl multi loop on its own thread.
+//
+// Handles come from HttpPool, so transfers share its DNS and TLS session
+// caches and endpoint policies with the blocking pooledGet(). Connections
+// are reused through the multi handle's own connection cache. Any
+// number of requests can be in flight at once. Callbacks run on the loop
+// thread and must not block.
+//
+// Where the server speaks HTTP/2, concurrent requests to one host are
+// multiplexed as streams over a single TLS connection. Otherwise they fall
+// back to parallel HTTP/1.1 keep-alive connections. Each request's time from
+// submission to completion is recorded as "<path> stream".
+class AsyncHttpClient {
+public:
+    typedef std::function<void(HttpResponse&&)> Callback;
+
+    static AsyncHttpClient& instance();
+
+    void get(const std::string& url, const std::vector<std::string>& headers, Callback callback);
+    std::future<HttpResponse> get(const std::string& url, const std::vector<std::string>& headers = {});
+
+    struct Stats {
+        uint64_t completed;
+        uint64_t http2;           // completed over HTTP/2
+        uint64_t http1;           // completed over HTTP/1.x
+        uint64_t newConnections;  // connections opened, as reported by curl
+        size_t inFlight;
+        size_t maxInFlight;
+    };
+    Stats stats() const;
+
+    size_t inFlight() const { return inFlight_.load(std::memory_order_relaxed); }
+
+private:
+    struct Transfer {
+        CURL* handle = nullptr;
+        std::string url;
+        struct curl_slist* headers = nullptr;
+        HttpResponse response;
+        Callback callback;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    AsyncHttpClient();
+    ~AsyncHttpClient();
+    AsyncHttpClient(const AsyncHttpClient&) = delete;
+    AsyncHttpClient& operator=(const AsyncHttpClient&) = delete;
+
+    void run();
+    void startPending();
+    void finish(CURLMsg* msg);
+
+    CURLM* multi_;
+    std::thread loop_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> inFlight_{0};
+    std::atomic<size_t> maxInFlight_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> http2_{0};
+    std::atomic<uint64_t> http1_{0};
+    std::atomic<uint64_t> newConnections_{0};
+
+    std::mutex pendingMutex_;
+    std::vector<Transfer*> pending_;
+    std::set<Transfer*> active_;  // loop thread only
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "spsc_queue.hpp"
+
+// Logging for the hot path.
+//
+// A log call copies its arguments into a fixed-size binary record and pushes
+// it onto the calling thread's own SPSC ring. A background thread formats the
+// records and writes them out. The calling thread never allocates, formats or
+// touches a stream, and drops the record (counted) rather than block when its
+// ring is full.
+//
+// Format strings must be string literals with "{}" placeholders. Levels below
+// LOG_COMPILED_LEVEL are compiled out; the rest are filtered by setLevel().
+
+enum class LogLevel : uint8_t { Debug = 0, Info = 1, Warn = 2, Error = 3, Off = 4 };
+
+// "debug", "info", "warn", "error" or "off"; anything else is Info.
+LogLevel parseLogLevel(const std::string& name);
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL 0
+#endif
+
+struct LogArg {
+    enum class Type : uint8_t { Int, Uint, Double, Text };
+    Type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        struct {
+            uint16_t offset;
+            uint16_t length;
+        } text;
+    };
+};
+
+struct LogRecord {
+    static constexpr size_t kMaxArgs = 6;
+    static constexpr size_t kTextBytes = 160;  // string arguments are truncated to fit
+
+    enum Sink : uint8_t { Console = 1, BenchmarkFile = 2 };
+
+    const char* format;
+    LogLevel level;
+    uint8_t sinks;
+    uint8_t argCount;
+    uint16_t textUsed;
+    LogArg args[kMaxArgs];
+    char text[kTextBytes];
+};
+
+namespace logdetail {
+
+inline void appendText(LogRecord& record, LogArg& arg, std::string_view value) {
+    size_t room = LogRecord::kTextBytes - record.textUsed;
+    size_t length = value.size() < room ? value.size() : room;
+    std::memcpy(record.text + record.textUsed, value.data(), length);
+    arg.type = LogArg::Type::Text;
+    arg.text.offset = record.textUsed;
+    arg.text.length = static_cast<uint16_t>(length);
+    record.textUsed += static_cast<uint16_t>(length);
+}
+
+template <typename T>
+void encodeArg(LogRecord& record, const T& value) {
+    if (record.argCount == LogRecord::kMaxArgs) return;
+    LogArg& arg = record.args[record.argCount++];
+
+    if constexpr (std::is_same_v<T, bool>) {
+        appendText(record, arg, value ? "true" : "false");
+    } else if constexpr (std::is_floating_point_v<T>) {
+        arg.type = LogArg::Type::Double;
+        arg.d = value;
+    } else if constexpr (std::is_enum_v<T>) {
+        arg.type = LogArg::Type::Int;
+        arg.i = static_cast<int64_t>(value);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        arg.type = LogArg::Type::Int;
+        arg.i = value;
+    } else if constexpr (std::is_integral_v<T>) {
+        arg.type = LogArg::Type::Uint;
+        arg.u = value;
+    } else {
+        appendText(record, arg, std::string_view(value));
+    }
+}
+
+} // namespace logdetail
+
+class AsyncLogger {
+public:
+    static AsyncLogger& instance();
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    void setLevel(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= level_.load(std::memory_order_relaxed); }
+
+    template <typename... Args>
+    void log(LogLevel level, uint8_t sinks, const char* format, const Args&... args) {
+        LogRecord record;
+        record.format = format;
+        record.level = level;
+        record.sinks = sinks;
+        record.argCount = 0;
+        record.textUsed = 0;
+        (logdetail::encodeArg(record, args), ...);
+        push(std::move(record));
+    }
+
+    // Cold path for preformatted lines of any length (benchmark reports).
+    void logLine(LogLevel level, uint8_t sinks, std::string line);
+
+    // Console records go here instead of stdout/stderr; nullptr restores them.
+    // The stream must outlive the next flush().
+    void setConsoleStream(std::ostream* out) { console_.store(out, std::memory_order_release); }
+
+    // Blocks until everything logged so far has been written.
+    void flush();
+
+    // Records dropped because a thread's ring was full.
+    uint64_t dropped() const;
+
+private:
+    static constexpr size_t kRingSize = 8192;
+
+    struct Producer {
+        SpscQueue<LogRecord> ring{kRingSize};
+        std::atomic<uint64_t> pushed{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    AsyncLogger();
+    Producer& producer();
+    void push(LogRecord&& record);
+    void run();
+    size_t drain(std::vector<Producer*>& producers);
+    void write(LogLevel level, uint8_t sinks, const std::string& line);
+    std::string format(const LogRecord& record) const;
+
+    std::atomic<LogLevel> level_{LogLevel::Info};
+    std::atomic<std::ostream*> console_{nullptr};
+
+    mutable std::mutex producersMutex_;
+    std::vector<std::unique_ptr<Producer>> producers_;
+    std::atomic<size_t> producerCount_{0};
+
+    struct Line {
+        LogLevel level;
+        uint8_t sinks;
+        std::string text;
+    };
+    std::mutex linesMutex_;
+    std::vector<Line> lines_;
+    std::atomic<uint64_t> linesQueued_{0};
+
+    std::ofstream benchmarkLog_;  // writer thread only
+    std::atomic<uint64_t> written_{0};
+    std::atomic<bool> running_{true};
+    std::thread writer_;
+};
+
+#define LOG_AT(level, sinks, ...)                                           \
+    do {                                                                    \
+        AsyncLogger& logger_ = AsyncLogger::instance();                     \
+        if (logger_.enabled(level)) logger_.log(level, sinks, __VA_ARGS__); \
+    } while (0)
+
+#if LOG_COMPILED_LEVEL <= 0
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, LogRecord::Console, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= 1
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, LogRecord::Console, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+// Appended to benchmark.log whatever the log level, like logBenchmark();
+// echoed to the console only when Info is enabled.
+#define LOG_BENCH(...)                                                                   \
+    do {                                                                                 \
+        AsyncLogger& logger_ = AsyncLogger::instance();                                  \
+        bool console_ = LOG_COMPILED_LEVEL <= 1 && logger_.enabled(LogLevel::Info);      \
+        uint8_t sinks_ = LogRecord::BenchmarkFile | (console_ ? LogRecord::Console : 0); \
+        logger_.log(LogLevel::Info, sinks_, __VA_ARGS__);                                \
+    } while (0)
+
+#if LOG_COMPILED_LEVEL <= 2
+#define LOG_WARN(...) LOG_AT(LogLevel::Warn, LogRecord::Console, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= 3
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, LogRecord::Console, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
@@ -0,0 +1,1455 @@
+#include "benchmarks.hpp"
+#include "utils.hpp"
+#include "http_pool.hpp"
+#include "async_http.hpp"
+#include "deribit_config.hpp"
+#include "alloc_counter.hpp"
+#include "request_builder.hpp"
+#include "order_types.hpp"
+#include "token_manager.hpp"
+#include "websocket_server.hpp"
+#include "client_session.hpp"
+#include "order_book.hpp"
+#include "book_sync.hpp"
+#include "feed_decoder.hpp"
+#include "async_logger.hpp"
+#include "feed_capture.hpp"
+#include "mock_exchange.hpp"
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <fstream>
+#include <unordered_map>
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+typedef websocketpp::client<websocketpp::config::asio_client> PlainClientType;
+
+double elapsedMs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void report(const std::string& line) {
+    logBenchmark(line);
+    std::cout << line << std::endl;
+}
+
+// "avg X, p50 X, p99 X, max X" over the samples (sorted in place).
+std::string summarize(std::vector<double>& samples, const std::string& unit) {
+    if (samples.empty()) return "no samples";
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) {
+        return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+    };
+    double avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    return "avg " + std::to_string(avg) + " " + unit +
+           ", p50 " + std::to_string(pct(0.50)) + " " + unit +
+           ", p99 " + std::to_string(pct(0.99)) + " " + unit +
+           ", max " + std::to_string(samples.back()) + " " + unit;
+}
+
+// Cold vs warm GET latency through the shared connection pool.
+// usage: http-reuse <url> [iterations] [--insecure]
+int benchHttpReuse(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "usage: --bench http-reuse <url> [iterations] [--insecure]" << std::endl;
+        return 1;
+    }
+
+    const std::string& url = args[0];
+    int iterations = 20;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--insecure") {
+            HttpPool::instance().setVerifyPeer(false);
+        } else {
+            iterations = std::max(1, std::stoi(args[i]));
+        }
+    }
+
+    std::string response;
+    auto start = Clock::now();
+    CURLcode res = pooledGet(url, nullptr, response);
+    double firstMs = elapsedMs(start, Clock::now());
+    if (res != CURLE_OK) {
+        std::cerr << "[ERROR] Curl request failed: " << curl_easy_strerror(res) << std::endl;
+        return 1;
+    }
+
+    double total = 0, best = 0, worst = 0;
+    for (int i = 0; i < iterations; ++i) {
+        response.clear();
+        start = Clock::now();
+        res = pooledGet(url, nullptr, response);
+        double ms = elapsedMs(start, Clock::now());
+        if (res != CURLE_OK) {
+            std::cerr << "[ERROR] Curl request failed: " << curl_easy_strerror(res) << std::endl;
+            return 1;
+        }
+        total += ms;
+        best = (i == 0) ? ms : std::min(best, ms);
+        worst = std::max(worst, ms);
+    }
+
+    report("[BENCH] http-reuse " + url + " first call took " + std::to_string(firstMs) + " ms");
+    report("[BENCH] http-reuse " + url + " warm calls (" + std::to_string(iterations) + "): avg " +
+           std::to_string(total / iterations) + " ms, min " + std::to_string(best) +
+           " ms, max " + std::to_string(worst) + " ms");
+    return 0;
+}
+
+// Order round trip over the Deribit WebSocket, e.g. against a local mock
+// JSON-RPC server that answers private/buy with a canned response.
+// usage: ws-orders <wss-url> [orders] [local-port]
+int benchWsOrders(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "usage: --bench ws-orders <wss-url> [orders] [local-port]" << std::endl;
+        return 1;
+    }
+
+    const std::string& url = args[0];
+    int orders = args.size() > 1 ? std::max(1, std::stoi(args[1])) : 100;
+    uint16_t port = args.size() > 2 ? static_cast<uint16_t>(std::stoi(args[2])) : 9102;
+
+    WebSocketServer server(url);
+    std::thread serverThread([&server, port]() { server.run(port); });
+
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (!server.isDeribitConnected() && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    int rc = 0;
+    if (!server.isDeribitConnected()) {
+        std::cerr << "[ERROR] Could not connect to " << url << std::endl;
+        rc = 1;
+    } else {
+        std::vector<double> samples;
+        int errors = 0;
+        for (int i = 0; i < orders; ++i) {
+            auto start = Clock::now();
+            auto response = server.placeBuyOrder("BTC-PERPETUAL", 10, 0, "market");
+            if (response.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+                std::cerr << "[ERROR] Order " << i << " timed out" << std::endl;
+                rc = 1;
+                break;
+            }
+            samples.push_back(elapsedMs(start, Clock::now()));
+            if (response.get().contains("error")) ++errors;
+        }
+        report("[BENCH] ws-orders " + url + " round trip (" + std::to_string(samples.size()) +
+               " orders, " + std::to_string(errors) + " errors): " + summarize(samples, "ms"));
+    }
+
+    server.stop();
+    serverThread.join();
+    return rc;
+}
+
+// Loads the book.* notifications from a file with one raw Deribit message per line.
+std::vector<BookUpdate> loadBookUpdates(const std::string& path) {
+    std::vector<BookUpdate> updates;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        json message = json::parse(line, nullptr, false);
+        if (message.is_discarded() || !message.contains("params") || !message["params"].contains("data")) continue;
+
+        BookUpdate update;
+        if (parseBookUpdate(message["params"]["data"], update)) {
+            updates.push_back(std::move(update));
+        }
+    }
+    return updates;
+}
+
+// Replays a recorded book stream through OrderBook and times every apply.
+// usage: book-replay <file> [passes]
+int benchBookReplay(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "usage: --bench book-replay <file> [passes]" << std::endl;
+        return 1;
+    }
+
+    int passes = args.size() > 1 ? std::max(1, std::stoi(args[1])) : 10;
+    std::vector<BookUpdate> updates = loadBookUpdates(args[0]);
+    if (updates.empty()) {
+        std::cerr << "[ERROR] No book updates found in " << args[0] << std::endl;
+        return 1;
+    }
+
+    std::vector<double> samples;
+    samples.reserve(updates.size() * passes);
+    std::unordered_map<std::string, OrderBook> books;
+    double checksum = 0;
+
+    auto wallStart = Clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        books.clear();
+        for (const auto& update : updates) {
+            auto it = books.find(update.instrument);
+            if (it == books.end()) {
+                it = books.emplace(update.instrument, OrderBook(update.instrument)).first;
+            }
+            auto start = Clock::now();
+            it->second.apply(update);
+            const PriceLevel* bid = it->second.bestBid();
+            auto end = Clock::now();
+            samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+            if (bid) checksum += bid->price;
+        }
+    }
+    double wallSec = std::chrono::duration<double>(Clock::now() - wallStart).count();
+
+    report("[BENCH] book-replay " + args[0] + ": " + std::to_string(samples.size()) + " updates in " +
+           std::to_string(wallSec) + " s (" + std::to_string(samples.size() / wallSec) +
+           " updates/s), apply " + summarize(samples, "ns") +
+           " [checksum " + std::to_string(checksum) + "]");
+    return 0;
+}
+
+// The whole book as a snapshot update, standing in for a REST get_order_book reply.
+BookUpdate snapshotOf(const OrderBook& book) {
+    std::vector<PriceLevel> bids, asks;
+    book.snapshot(std::max(book.bidLevels(), book.askLevels()), bids, asks);
+
+    BookUpdate update;
+    update.instrument = book.instrument();
+    update.snapshot = true;
+    update.changeId = book.changeId();
+    update.timestamp = book.timestamp();
+    for (const auto& level : bids) update.bids.push_back(LevelUpdate{BookAction::New, level.price, level.amount});
+    for (const auto& level : asks) update.asks.push_back(LevelUpdate{BookAction::New, level.price, level.amount});
+    return update;
+}
+
+bool sameBook(const OrderBook& a, const OrderBook& b) {
+    const size_t all = std::numeric_limits<size_t>::max();
+    std::vector<PriceLevel> aBids, aAsks, bBids, bAsks;
+    a.snapshot(all, aBids, aAsks);
+    b.snapshot(all, bBids, bAsks);
+    if (a.bidLevels() != b.bidLevels() || a.askLevels() != b.askLevels()) return false;
+    auto same = [](const std::vector<PriceLevel>& x, const std::vector<PriceLevel>& y) {
+        return std::equal(x.begin(), x.end(), y.begin(), [](const PriceLevel& l, const PriceLevel& r) {
+            return l.price == r.price && l.amount == r.amount;
+        });
+    };
+    return same(aBids, bBids) && same(aAsks, bAsks);
+}
+
+// Replays a recorded book stream through BookSync while dropping deltas to
+// inject sequence gaps. Resync requests are answered by an in-process replay
+// server `lag` messages later with a snapshot of a reference book that saw
+// every update; each published book is checked against that reference.
+// usage: book-resync <file> [drop-every] [lag]
+int benchBookResync(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "usage: --bench book-resync <file> [drop-every] [lag]" << std::endl;
+        return 1;
+    }
+
+    size_t dropEvery = args.size() > 1 ? std::stoul(args[1]) : 500;
+    size_t lag = args.size() > 2 ? std::stoul(args[2]) : 5;
+    std::vector<BookUpdate> updates = loadBookUpdates(args[0]);
+    if (updates.empty()) {
+        std::cerr << "[ERROR] No book updates found in " << args[0] << std::endl;
+        return 1;
+    }
+
+    struct PendingSnapshot { std::string instrument; size_t dueAt; };
+    std::vector<PendingSnapshot> pending;
+    std::unordered_map<std::string, OrderBook> reference;
+    std::unordered_map<std::string, BookSync> syncs;
+    std::vector<double> recoveryMs;
+    size_t dropped = 0, published = 0, corrupt = 0, index = 0;
+
+    auto syncFor = [&](const std::string& instrument) -> BookSync& {
+        auto it = syncs.find(instrument);
+        if (it == syncs.end()) {
+            it = syncs.emplace(instrument, BookSync(instrument, instrument, [&](const std::string& name) {
+                pending.push_back(PendingSnapshot{name, index + lag});
+            })).first;
+        }
+        return it->second;
+    };
+
+    for (index = 0; index < updates.size(); ++index) {
+        const BookUpdate& update = updates[index];
+        auto ref = reference.find(update.instrument);
+        if (ref == reference.end()) {
+            ref = reference.emplace(update.instrument, OrderBook(update.instrument)).first;
+        }
+        ref->second.apply(update);
+
+        for (size_t p = 0; p < pending.size();) {
+            if (pending[p].dueAt > index) { ++p; continue; }
+            BookSync& sync = syncFor(pending[p].instrument);
+            if (sync.onSnapshot(snapshotOf(reference.at(pending[p].instrument)))) {
+                recoveryMs.push_back(sync.lastRecoveryMs());
+            }
+            pending.erase(pending.begin() + p);
+        }
+
+        if (!update.snapshot && dropEvery > 0 && index % dropEvery == dropEvery - 1) {
+            ++dropped;
+            continue;
+        }
+
+        BookSync& sync = syncFor(update.instrument);
+        bool wasResyncing = sync.state() == BookSync::State::Resyncing;
+        if (sync.onUpdate(update)) {
+            ++published;
+            if (wasResyncing) recoveryMs.push_back(sync.lastRecoveryMs());
+            if (!sameBook(sync.book(), ref->second)) ++corrupt;
+        }
+    }
+
+    uint64_t gaps = 0;
+    for (const auto& entry : syncs) gaps += entry.second.gaps();
+
+    report("[BENCH] book-resync " + args[0] + ": " + std::to_string(updates.size()) + " updates, " +
+           std::to_string(dropped) + " dropped, " + std::to_string(gaps) + " gaps detected, " +
+           std::to_string(recoveryMs.size()) + " recoveries, " + std::to_string(published) +
+           " published, " + std::to_string(corrupt) + " corrupt");
+    report("[BENCH] book-resync recovery time: " + summarize(recoveryMs, "ms"));
+    return corrupt == 0 ? 0 : 1;
+}
+
+// Decodes a corpus of captured messages (book, trades, ticker; one per line)
+// with the nlohmann DOM path and the simdjson on-demand path.
+// usage: parse-compare <file> [passes]
+int benchParseCompare(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "usage: --bench parse-compare <file> [passes]" << std::endl;
+        return 1;
+    }
+
+    int passes = args.size() > 1 ? std::max(1, std::stoi(args[1])) : 20;
+    std::vector<std::string> corpus;
+    size_t bytes = 0;
+    {
+        std::ifstream file(args[0]);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty()) continue;
+            bytes += line.size();
+            corpus.push_back(std::move(line));
+        }
+    }
+    if (corpus.empty()) {
+        std::cerr << "[ERROR] No messages found in " << args[0] << std::endl;
+        return 1;
+    }
+
+    std::string channel;
+    BookUpdate update;
+    size_t decodedBooks = 0;
+
+    auto run = [&](const std::string& label, const std::function<void(const std::string&)>& decode) {
+        decodedBooks = 0;
+        auto start = Clock::now();
+        for (int pass = 0; pass < passes; ++pass) {
+            for (const auto& message : corpus) decode(message);
+        }
+        double sec = std::chrono::duration<double>(Clock::now() - start).count();
+        double messages = static_cast<double>(corpus.size()) * passes;
+        report("[BENCH] parse-compare " + label + ": " + std::to_string(messages / sec) + " msg/s, " +
+               std::to_string(bytes * passes / sec / (1024 * 1024)) + " MB/s (" +
+               std::to_string(decodedBooks / passes) + " book updates per pass)");
+    };
+
+    run("nlohmann", [&](const std::string& message) {
+        json parsed = json::parse(message, nullptr, false);
+        if (parsed.is_discarded() || !parsed.contains("params")) return;
+        const json& params = parsed["params"];
+        channel = params.value("channel", "");
+        if (channel.compare(0, 5, "book.") == 0 && parseBookUpdate(params["data"], update)) ++decodedBooks;
+    });
+
+    FeedDecoder decoder;
+    run("simdjson", [&](const std::string& message) {
+        if (decoder.decode(message, channel, update) == FeedDecoder::Kind::Book) ++decodedBooks;
+    });
+    return 0;
+}
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// Thousands of local clients need more descriptors than the usual soft limit.
+void raiseFileLimit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+double threadCpuMs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Fan-out load test: a local server broadcasts timestamped messages to N
+// local clients. Reports delivery latency and server-thread CPU per message;
+// --copy uses the old per-client send(payload) path for comparison.
+// usage: fanout <clients> [messages] [rate/s] [bytes] [port] [--copy]
+int benchFanout(const std::vector<std::string>& args) {
+    std::vector<std::string> positional;
+    bool copyPerClient = false;
+    for (const auto& arg : args) {
+        if (arg == "--copy") copyPerClient = true;
+        else positional.push_back(arg);
+    }
+    if (positional.empty()) {
+        std::cerr << "usage: --bench fanout <clients> [messages] [rate/s] [bytes] [port] [--copy]" << std::endl;
+        return 1;
+    }
+
+    size_t clients = std::stoul(positional[0]);
+    size_t messages = positional.size() > 1 ? std::stoul(positional[1]) : 1000;
+    double rate = positional.size() > 2 ? std::stod(positional[2]) : 100;
+    size_t bytes = positional.size() > 3 ? std::stoul(positional[3]) : 512;
+    std::string port = positional.size() > 4 ? positional[4] : "9200";
+    raiseFileLimit();
+
+    WebsocketServerType server;
+    server.clear_access_channels(websocketpp::log::alevel::all);
+    server.clear_error_channels(websocketpp::log::elevel::all);
+    server.init_asio();
+    server.set_reuse_addr(true);
+
+    std::mutex connectionsMutex;
+    std::vector<websocketpp::connection_hdl> connections;
+    server.set_open_handler([&](websocketpp::connection_hdl hdl) {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connections.push_back(hdl);
+    });
+    server.listen(static_cast<uint16_t>(std::stoi(port)));
+    server.start_accept();
+    std::thread serverThread([&server]() { server.run(); });
+
+    // Client side: one io thread, so the latency vectors need no locking.
+    PlainClientType client;
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.clear_error_channels(websocketpp::log::elevel::all);
+    client.init_asio();
+
+    std::vector<double> deliveryUs;
+    deliveryUs.reserve(clients * messages);
+    std::vector<int64_t> lastDeliveryNs(messages, 0);
+    std::atomic<size_t> received{0};
+    client.set_message_handler([&](websocketpp::connection_hdl, PlainClientType::message_ptr msg) {
+        int64_t now = nowNs();
+        const std::string& payload = msg->get_payload();
+        size_t seqPos = payload.find("\"seq\":");
+        size_t sentPos = payload.find("\"sent_ns\":");
+        if (seqPos == std::string::npos || sentPos == std::string::npos) return;
+        size_t seq = std::strtoull(payload.c_str() + seqPos + 6, nullptr, 10);
+        int64_t sent = std::strtoll(payload.c_str() + sentPos + 10, nullptr, 10);
+        deliveryUs.push_back((now - sent) / 1e3);
+        if (seq < messages) lastDeliveryNs[seq] = std::max(lastDeliveryNs[seq], now - sent);
+        received.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    for (size_t i = 0; i < clients; ++i) {
+        websocketpp::lib::error_code ec;
+        auto con = client.get_connection("ws://127.0.0.1:" + port, ec);
+        if (ec) {
+            std::cerr << "[ERROR] Could not create client connection: " << ec.message() << std::endl;
+            break;
+        }
+        client.connect(con);
+    }
+    std::thread clientThread([&client]() { client.run(); });
+
+    auto connectedCount = [&]() {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        return connections.size();
+    };
+    auto deadline = Clock::now() + std::chrono::seconds(30);
+    while (connectedCount() < clients && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    size_t connected = connectedCount();
+
+    clockid_t serverCpu;
+    pthread_getcpuclockid(serverThread.native_handle(), &serverCpu);
+    double cpuStart = threadCpuMs(serverCpu);
+
+    std::string padding(bytes > 64 ? bytes - 64 : 0, 'x');
+    auto interval = std::chrono::duration<double>(1.0 / std::max(rate, 1e-3));
+    for (size_t seq = 0; seq < messages; ++seq) {
+        server.get_io_service().post([&, seq]() {
+            std::string payload = "{\"seq\":" + std::to_string(seq) + ",\"sent_ns\":" +
+                                  std::to_string(nowNs()) + ",\"pad\":\"" + padding + "\"}";
+            websocketpp::lib::error_code ec;
+            if (copyPerClient) {
+                for (const auto& hdl : connections) server.send(hdl, payload, websocketpp::frame::opcode::text, ec);
+            } else {
+                WebsocketServerType::message_ptr frame = WebSocketServer::prepareFrame(payload);
+                for (const auto& hdl : connections) server.send(hdl, frame, ec);
+            }
+        });
+        std::this_thread::sleep_for(interval);
+    }
+
+    size_t expected = connected * messages;
+    deadline = Clock::now() + std::chrono::seconds(30);
+    while (received.load() < expected && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double cpuMs = threadCpuMs(serverCpu) - cpuStart;
+
+    client.stop();
+    clientThread.join();
+    server.stop_listening();
+    server.stop();
+    serverThread.join();
+
+    std::vector<double> lastUs;
+    for (int64_t ns : lastDeliveryNs) {
+        if (ns > 0) lastUs.push_back(ns / 1e3);
+    }
+
+    std::string mode = copyPerClient ? "copy" : "shared";
+    report("[BENCH] fanout " + mode + " " + std::to_string(connected) + " clients, " +
+           std::to_string(messages) + " msgs of " + std::to_string(bytes) + " B, " +
+           std::to_string(received.load()) + "/" + std::to_string(expected) + " delivered");
+    report("[BENCH] fanout " + mode + " delivery latency: " + summarize(deliveryUs, "us"));
+    report("[BENCH] fanout " + mode + " last-client latency: " + summarize(lastUs, "us"));
+    report("[BENCH] fanout " + mode + " server CPU: " + std::to_string(cpuMs * 1e3 / messages) + " us/msg");
+    return received.load() == expected ? 0 : 1;
+}
+
+// Synthetic book feed for `channels` instruments: one snapshot per channel,
+// then `changes` chained deltas spread over random channels.
+std::vector<std::string> syntheticBookFeed(size_t channels, size_t changes) {
+    std::mt19937 rng(42);
+    std::vector<std::string> feed;
+    std::vector<int64_t> changeIds(channels, 1);
+    auto notification = [](const std::string& instrument, json data) {
+        return json({{"jsonrpc", "2.0"}, {"method", "subscription"},
+                     {"params", {{"channel", "book." + instrument + ".100ms"}, {"data", std::move(data)}}}}).dump();
+    };
+
+    for (size_t c = 0; c < channels; ++c) {
+        std::string instrument = "SYN-" + std::to_string(c);
+        json bids = json::array(), asks = json::array();
+        for (int level = 0; level < 20; ++level) {
+            bids.push_back({"new", 1000.0 - level * 0.5, 10.0 * (level + 1)});
+            asks.push_back({"new", 1000.5 + level * 0.5, 10.0 * (level + 1)});
+        }
+        feed.push_back(notification(instrument, {{"type", "snapshot"}, {"instrument_name", instrument},
+                                                 {"change_id", 1}, {"timestamp", 0}, {"bids", bids}, {"asks", asks}}));
+    }
+
+    std::uniform_int_distribution<size_t> pickChannel(0, channels - 1);
+    std::uniform_int_distribution<int> pickLevel(0, 19);
+    for (size_t i = 0; i < changes; ++i) {
+        size_t c = pickChannel(rng);
+        std::string instrument = "SYN-" + std::to_string(c);
+        int64_t prev = changeIds[c]++;
+        int level = pickLevel(rng);
+        json bids = json::array({json::array({"change", 1000.0 - level * 0.5, double(rng() % 1000)})});
+        json asks = json::array({json::array({"change", 1000.5 + level * 0.5, double(rng() % 1000)})});
+        feed.push_back(notification(instrument, {{"type", "change"}, {"instrument_name", instrument},
+                                                 {"change_id", changeIds[c]}, {"prev_change_id", prev},
+                                                 {"timestamp", int64_t(i)}, {"bids", bids}, {"asks", asks}}));
+    }
+    return feed;
+}
+
+// Per-message cost of WebSocketServer's feed dispatch (decode, route to the
+// channel's book, apply) with many subscribed channels.
+// usage: dispatch-stress [channels] [changes]
+int benchDispatchStress(const std::vector<std::string>& args) {
+    size_t channels = args.size() > 0 ? std::max<size_t>(1, std::stoul(args[0])) : 1000;
+    size_t changes = args.size() > 1 ? std::stoul(args[1]) : 200000;
+    std::vector<std::string> feed = syntheticBookFeed(channels, changes);
+
+    WebSocketServer server;
+    std::vector<std::string> instruments;
+    for (size_t c = 0; c < channels; ++c) instruments.push_back("SYN-" + std::to_string(c));
+    server.setInstruments(instruments);
+
+    std::vector<double> samples;
+    samples.reserve(feed.size());
+    auto wallStart = Clock::now();
+    for (const auto& message : feed) {
+        auto start = Clock::now();
+        server.dispatchFeedMessage(message);
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    double wallSec = std::chrono::duration<double>(Clock::now() - wallStart).count();
+
+    report("[BENCH] dispatch-stress " + std::to_string(channels) + " channels, " +
+           std::to_string(feed.size()) + " messages: " + std::to_string(feed.size() / wallSec) +
+           " msg/s, dispatch " + summarize(samples, "ns"));
+    return 0;
+}
+
+// Per-message cost of the feed dispatch with the per-message debug lines
+// filtered out vs enabled (records formatted and written to /dev/null by the
+// logger thread).
+// usage: log-overhead [channels] [changes]
+int benchLogOverhead(const std::vector<std::string>& args) {
+    size_t channels = args.size() > 0 ? std::max<size_t>(1, std::stoul(args[0])) : 100;
+    size_t changes = args.size() > 1 ? std::stoul(args[1]) : 200000;
+    std::vector<std::string> feed = syntheticBookFeed(channels, changes);
+
+    std::vector<std::string> instruments;
+    for (size_t c = 0; c < channels; ++c) instruments.push_back("SYN-" + std::to_string(c));
+
+    AsyncLogger& logger = AsyncLogger::instance();
+    LogLevel savedLevel = logger.level();
+    std::ofstream devNull("/dev/null");
+
+    auto run = [&](const std::string& label, LogLevel level) {
+        WebSocketServer server;
+        server.setInstruments(instruments);
+        logger.flush();
+        logger.setConsoleStream(&devNull);
+        logger.setLevel(level);
+        uint64_t droppedBefore = logger.dropped();
+
+        std::vector<double> samples;
+        samples.reserve(feed.size());
+        for (const auto& message : feed) {
+            auto start = Clock::now();
+            server.dispatchFeedMessage(message);
+            samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+
+        auto drainStart = Clock::now();
+        logger.flush();
+        double drainMs = elapsedMs(drainStart, Clock::now());
+        logger.setLevel(savedLevel);
+        logger.setConsoleStream(nullptr);
+
+        report("[BENCH] log-overhead " + label + ": dispatch " + summarize(samples, "ns") +
+               ", dropped " + std::to_string(logger.dropped() - droppedBefore) +
+               ", writer drain " + std::to_string(drainMs) + " ms");
+    };
+
+    run("off", LogLevel::Off);
+    run("debug", LogLevel::Debug);
+    return 0;
+}
+
+// Writes the synthetic book feed as a capture, one frame per millisecond, so
+// replay benchmarks run without a recorded session.
+// usage: make-capture <out> [channels] [changes]
+int benchMakeCapture(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "usage: --bench make-capture <out> [channels] [changes]" << std::endl;
+        return 1;
+    }
+    size_t channels = args.size() > 1 ? std::max<size_t>(1, std::stoul(args[1])) : 100;
+    size_t changes = args.size() > 2 ? std::stoul(args[2]) : 200000;
+
+    FeedCaptureWriter writer;
+    if (!writer.open(args[0])) return 1;
+    int64_t t = 1000000000;
+    for (const auto& message : syntheticBookFeed(channels, changes)) {
+        writer.append(t, message);
+        t += 1000000;
+    }
+    report("[BENCH] make-capture wrote " + std::to_string(writer.records()) + " frames to " + args[0]);
+    return 0;
+}
+
+// Replays a capture through the full receive path (SPSC handoff, decode,
+// books) with no network.
+// usage: feed-replay <capture> [speed|max]
+int benchFeedReplay(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "usage: --bench feed-replay <capture> [speed|max]" << std::endl;
+        return 1;
+    }
+    double speed = args.size() > 1 && args[1] != "max" ? std::stod(args[1]) : 0.0;
+
+    WebSocketServer server;
+    auto start = Clock::now();
+    int64_t frames = server.replayCapture(args[0], speed);
+    double sec = std::chrono::duration<double>(Clock::now() - start).count();
+    if (frames < 0) return 1;
+
+    WebSocketServer::FeedStats stats = server.feedStats();
+    LatencyHistogram& dispatch = latency("feed dispatch");
+    report("[BENCH] feed-replay " + std::to_string(frames) + " frames in " + std::to_string(sec) + " s (" +
+           std::to_string(frames / sec) + " msg/s), handoff avg " + std::to_string(stats.avgHandoffUs) +
+           " us, p99 " + std::to_string(stats.p99HandoffUs) + " us, dispatch p50 " +
+           std::to_string(dispatch.percentile(50) / 1000.0) + " us, p99 " +
+           std::to_string(dispatch.percentile(99) / 1000.0) + " us, max queue depth " +
+           std::to_string(stats.maxQueueDepth));
+    return 0;
+}
+
+// Wall time for a batch of N mixed public REST requests, one after another
+// through pooledGet vs all in flight at once on the curl multi loop (HTTP/2
+// streams on one connection where the server supports it).
+// usage: rest-batch [requests] [--insecure]
+int benchRestBatch(const std::vector<std::string>& args) {
+    int requests = 20;
+    for (const auto& arg : args) {
+        if (arg == "--insecure") {
+            HttpPool::instance().setVerifyPeer(false);
+        } else {
+            requests = std::max(1, std::stoi(arg));
+        }
+    }
+
+    const std::string& base = DeribitConfig::instance().restUrl;
+    const std::vector<std::string> mix = {
+        base + "/api/v2/public/get_order_book?instrument_name=BTC-PERPETUAL&depth=10",
+        base + "/api/v2/public/get_order_book?instrument_name=ETH-PERPETUAL&depth=10",
+        base + "/api/v2/public/get_instruments?currency=BTC&kind=future&expired=false",
+        base + "/api/v2/public/test",
+    };
+
+    // Warm the pool so neither run pays the first handshake alone
+    std::string response;
+    if (pooledGet(mix[0], nullptr, response) != CURLE_OK) {
+        std::cerr << "[ERROR] Could not reach " << base << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < requests; ++i) {
+        response.clear();
+        if (pooledGet(mix[i % mix.size()], nullptr, response) != CURLE_OK) ++failures;
+    }
+    double sequentialMs = elapsedMs(start, Clock::now());
+
+    start = Clock::now();
+    std::vector<std::future<HttpResponse>> pending;
+    for (int i = 0; i < requests; ++i) {
+        pending.push_back(AsyncHttpClient::instance().get(mix[i % mix.size()]));
+    }
+    for (auto& future : pending) {
+        if (future.get().result != CURLE_OK) ++failures;
+    }
+    double concurrentMs = elapsedMs(start, Clock::now());
+    AsyncHttpClient::Stats stats = AsyncHttpClient::instance().stats();
+
+    report("[BENCH] rest-batch " + base + " x" + std::to_string(requests) +
+           ": sequential " + std::to_string(sequentialMs) + " ms, concurrent " +
+           std::to_string(concurrentMs) + " ms (" + std::to_string(sequentialMs / std::max(concurrentMs, 1e-3)) +
+           "x), " + std::to_string(failures) + " failed");
+    report("[BENCH] rest-batch concurrent: " + std::to_string(stats.http2) + " over HTTP/2, " +
+           std::to_string(stats.http1) + " over HTTP/1.x, " + std::to_string(stats.newConnections) +
+           " new connections, max " + std::to_string(stats.maxInFlight) + " streams in flight");
+    return failures == 0 ? 0 : 1;
+}
+
+// Heap allocations (operator new calls) and time per order on the client
+// side: buy + edit + cancel URLs, the auth header and decoding a canned ack.
+// The old concatenation/to_string builder runs alongside for comparison, and
+// a round-amount run checks that amounts such as 100000 stay in fixed notation.
+// --live also sends each buy to DERIBIT_ENV's target (the mock exchange,
+// say), reading the token from TokenManager per order and counting everything
+// but libcurl's own mallocs. Needs a `make ALLOC_COUNTER=1` build to count.
+// usage: order-alloc [orders] [--live]
+int benchOrderAlloc(const std::vector<std::string>& args) {
+    int orders = 100000;
+    bool live = false;
+    for (const auto& arg : args) {
+        if (arg == "--live") live = true;
+        else orders = std::max(1, std::stoi(arg));
+    }
+    if (!allocationCountingEnabled()) {
+        report("[BENCH] order-alloc: allocation counting is compiled out, rebuild with make ALLOC_COUNTER=1");
+    }
+    auto perOrder = [](uint64_t allocations, int count) {
+        return allocationCountingEnabled() ? std::to_string(double(allocations) / count) : std::string("n/a");
+    };
+
+    const std::string base = DeribitConfig::instance().restUrl;
+    const std::string instrument = "BTC-PERPETUAL", type = "limit", orderId = "BTC-5912345678";
+    const std::string token = "1a2b3c4d5e6f7a8b9c0d1a2b3c4d5e6f7a8b9c0d";
+    const std::string ackBody =
+        R"({"jsonrpc":"2.0","result":{"trades":[],"order":{"order_id":"BTC-5912345678","instrument_name":"BTC-PERPETUAL",)"
+        R"("direction":"buy","order_state":"open","price":60000.5,"amount":10.0,"filled_amount":0.0,"average_price":0.0,)"
+        R"("last_update_timestamp":1700000000000}},"usIn":1,"usOut":2,"usDiff":1,"testnet":true})";
+
+    // Shortest to_chars output is scientific for these ("1e+05"), and '+'
+    // decodes as a space in a query string.
+    for (double amount : {100000.0, 200000.0, 0.0001}) {
+        const std::string& url = orderUrl("buy", instrument, amount, 0, "market");
+        size_t from = url.find("&amount=") + 8;
+        std::string text = url.substr(from, url.find('&', from) - from);
+        if (text.find_first_of("e+") != std::string::npos) {
+            report("[BENCH] order-alloc: amount " + std::to_string(amount) + " written as " + text);
+            return 1;
+        }
+    }
+
+    auto legacy = [&](double amount, double price) {
+        std::string buy = base + "/api/v2/private/buy?" "instrument_name=" + instrument +
+                          "&amount=" + std::to_string(amount) + "&type=" + type + "&price=" + std::to_string(price);
+        std::string edit = base + "/api/v2/private/edit?" "order_id=" + orderId +
+                           "&amount=" + std::to_string(amount * 2) + "&price=" + std::to_string(price);
+        std::string cancel = base + "/api/v2/private/cancel?order_id=" + orderId;
+        struct curl_slist* headers = curl_slist_append(nullptr, ("Authorization: Bearer " + token).c_str());
+        curl_slist_free_all(headers);
+        return buy.size() + edit.size() + cancel.size();
+    };
+    AuthHeader auth;
+    OrderAck ack;
+    auto current = [&](double amount, double price) {
+        size_t size = orderUrl("buy", instrument, amount, price, type).size();
+        size += editUrl(orderId, amount * 2, price).size();
+        size += cancelUrl(orderId).size();
+        size += auth.get(token) != nullptr;
+        OrderDecoder::local().decodeAck(ackBody, ack);
+        return size;
+    };
+
+    auto measure = [&](const char* name, double amount, const std::function<size_t(double, double)>& build) {
+        build(amount, 60000.5);  // warm buffers and thread-local caches
+        size_t sink = 0;
+        uint64_t before = threadAllocations();
+        auto start = Clock::now();
+        for (int i = 0; i < orders; ++i) sink += build(amount, 60000.0 + (i % 200) * 0.5);
+        double ns = elapsedMs(start, Clock::now()) * 1e6 / orders;
+        report("[BENCH] order-alloc " + std::string(name) + ": " + perOrder(threadAllocations() - before, orders) +
+               " allocations/order, " + std::to_string(ns) + " ns/order (" + std::to_string(sink % 10) + ")");
+    };
+    measure("concat", 10.0, legacy);
+    measure("builder", 10.0, current);
+    measure("builder round-amount", 100000.0, current);
+
+    if (live) {
+        std::string clientId = getEnvValue("DERIBIT_CLIENT_ID"), clientSecret = getEnvValue("DERIBIT_CLIENT_SECRET");
+        DeribitConfig::instance().apply();
+        TokenManager tokens;
+        if (!tokens.start(clientId, clientSecret)) return 1;
+        int sent = std::min(orders, 1000);
+        placeBuyOrder(*tokens.current(), instrument, 10, 60000, type);
+        uint64_t before = threadAllocations();
+        int failed = 0;
+        for (int i = 0; i < sent; ++i) {
+            if (!placeBuyOrder(*tokens.current(), instrument, 10, 60000.0 + (i % 200) * 0.5, type).ok) ++failed;
+        }
+        report("[BENCH] order-alloc live " + base + ": " + perOrder(threadAllocations() - before, sent) +
+               " allocations/order over " + std::to_string(sent) + " orders, " + std::to_string(failed) + " failed");
+    }
+    return 0;
+}
+
+// Local WebSocketServer on 1/2/4/8 io threads with 100/1,000/5,000 clients
+// subscribed to one synthetic book channel: messages/second delivered to the
+// clients. The clients run in this process on their own io threads, so on a
+// small machine they compete with the server for cores.
+// usage: server-scaling [changes] [port] [--pin]
+int benchServerScaling(const std::vector<std::string>& args) {
+    std::vector<std::string> positional;
+    bool pinThreads = false;
+    for (const auto& arg : args) {
+        if (arg == "--pin") pinThreads = true;
+        else positional.push_back(arg);
+    }
+    size_t changes = positional.size() > 0 ? std::stoul(positional[0]) : 500;
+    int basePort = positional.size() > 1 ? std::stoi(positional[1]) : 9300;
+    raiseFileLimit();
+
+    const std::string channel = "book.SYN-0.100ms";
+    std::vector<std::string> feed = syntheticBookFeed(1, changes);
+    unsigned clientThreads = std::max(2u, std::thread::hardware_concurrency() / 2);
+    int exitCode = 0;
+    int run = 0;
+
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        for (size_t clients : {size_t(100), size_t(1000), size_t(5000)}) {
+            std::string port = std::to_string(basePort + run++);
+
+            // The server logs every connect; keep that out of the report.
+            std::ofstream devNull("/dev/null");
+            std::streambuf* savedCout = std::cout.rdbuf(devNull.rdbuf());
+
+            auto server = std::make_unique<WebSocketServer>();
+            std::thread serverThread([&server, &port, threads, pinThreads]() {
+                server->serve(static_cast<uint16_t>(std::stoi(port)), threads, pinThreads);
+            });
+
+            PlainClientType client;
+            client.clear_access_channels(websocketpp::log::alevel::all);
+            client.clear_error_channels(websocketpp::log::elevel::all);
+            client.init_asio();
+
+            std::atomic<size_t> subscribed{0};
+            std::atomic<size_t> received{0};
+            std::atomic<int64_t> lastReceivedNs{0};
+            client.set_open_handler([&](websocketpp::connection_hdl hdl) {
+                websocketpp::lib::error_code ec;
+                client.send(hdl, "{\"id\":1,\"method\":\"subscribe\",\"params\":{\"channels\":[\"" + channel + "\"]}}",
+                            websocketpp::frame::opcode::text, ec);
+            });
+            client.set_message_handler([&](websocketpp::connection_hdl, PlainClientType::message_ptr msg) {
+                if (msg->get_payload().compare(0, 40, "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\"") == 0) {
+                    received.fetch_add(1, std::memory_order_relaxed);
+                    lastReceivedNs.store(nowNs(), std::memory_order_relaxed);
+                } else {
+                    subscribed.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+
+            // Give the listener a moment before connecting
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            for (size_t i = 0; i < clients; ++i) {
+                websocketpp::lib::error_code ec;
+                auto con = client.get_connection("ws://127.0.0.1:" + port, ec);
+                if (ec) break;
+                client.connect(con);
+            }
+            std::vector<std::thread> clientPool;
+            for (unsigned i = 0; i < clientThreads; ++i) {
+                clientPool.emplace_back([&client]() { client.run(); });
+            }
+
+            auto deadline = Clock::now() + std::chrono::seconds(60);
+            while (subscribed.load() < clients && Clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            size_t connected = subscribed.load();
+
+            int64_t startNs = nowNs();
+            for (const auto& message : feed) {
+                server->injectFrame(message);
+            }
+            size_t expected = connected * feed.size();
+            deadline = Clock::now() + std::chrono::seconds(60);
+            while (received.load() < expected && Clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            double sec = std::max<int64_t>(1, lastReceivedNs.load() - startNs) / 1e9;
+
+            client.stop();
+            for (auto& thread : clientPool) thread.join();
+            server->stop();
+            serverThread.join();
+            server.reset();
+            std::cout.rdbuf(savedCout);
+
+            report("[BENCH] server-scaling " + std::to_string(threads) + " threads" + (pinThreads ? " (pinned)" : "") +
+                   ", " + std::to_string(connected) + "/" + std::to_string(clients) + " clients: " +
+                   std::to_string(received.load()) + "/" + std::to_string(expected) + " delivered, " +
+                   std::to_string(static_cast<uint64_t>(received.load() / sec)) + " msg/s");
+            if (received.load() != expected || connected != clients) exitCode = 1;
+        }
+    }
+    return exitCode;
+}
+
+// One client that subscribes and then stops reading, next to N normal
+// clients, under a given slow-consumer policy (256 KB buffer limit). Reports
+// what the normal clients received and what happened to the stalled one.
+// --conflated subscribes the stalled client with conflated delivery instead.
+// usage: slow-consumer [drop-oldest|conflate|disconnect] [clients] [changes] [port] [--conflated]
+int benchSlowConsumer(const std::vector<std::string>& rawArgs) {
+    std::vector<std::string> args;
+    bool conflatedClient = false;
+    for (const auto& arg : rawArgs) {
+        if (arg == "--conflated") conflatedClient = true;
+        else args.push_back(arg);
+    }
+    BackpressurePolicy policy;
+    policy.maxBufferedBytes = 256 * 1024;
+    if (!args.empty() && !parseBackpressureMode(args[0], policy.mode)) {
+        std::cerr << "usage: --bench slow-consumer [drop-oldest|conflate|disconnect] [clients] [changes] [port] [--conflated]"
+                  << std::endl;
+        return 1;
+    }
+    size_t clients = args.size() > 1 ? std::stoul(args[1]) : 100;
+    size_t changes = args.size() > 2 ? std::stoul(args[2]) : 50000;
+    std::string port = args.size() > 3 ? args[3] : "9400";
+    raiseFileLimit();
+
+    const std::string channel = "book.SYN-0.100ms";
+    const std::string subscribe = "{\"id\":1,\"method\":\"subscribe\",\"params\":{\"channels\":[\"" + channel + "\"]}}";
+    std::vector<std::string> feed = syntheticBookFeed(1, changes);
+
+    std::ofstream devNull("/dev/null");
+    std::streambuf* savedCout = std::cout.rdbuf(devNull.rdbuf());
+
+    WebSocketServer server;
+    server.setBackpressurePolicy(policy);
+    std::thread serverThread([&server, &port]() { server.serve(static_cast<uint16_t>(std::stoi(port)), 2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // The stalled client: a raw socket with a tiny receive buffer that does
+    // the handshake, sends one (zero-masked) subscribe frame and never reads.
+    boost::asio::io_service stalledIo;
+    boost::asio::ip::tcp::socket stalled(stalledIo);
+    stalled.open(boost::asio::ip::tcp::v4());
+    stalled.set_option(boost::asio::socket_base::receive_buffer_size(4096));
+    stalled.connect({boost::asio::ip::address_v4::loopback(), static_cast<unsigned short>(std::stoi(port))});
+    boost::asio::write(stalled, boost::asio::buffer(std::string(
+        "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n")));
+    boost::asio::streambuf handshake;
+    boost::asio::read_until(stalled, handshake, "\r\n\r\n");
+    std::string stalledSubscribe = subscribe;
+    if (conflatedClient) {
+        stalledSubscribe.insert(stalledSubscribe.size() - 2, ",\"delivery\":\"conflated\"");
+    }
+    std::string frame{char(0x81), char(0x80 | stalledSubscribe.size()), 0, 0, 0, 0};
+    frame += stalledSubscribe;
+    boost::asio::write(stalled, boost::asio::buffer(frame));
+
+    PlainClientType client;
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.clear_error_channels(websocketpp::log::elevel::all);
+    client.init_asio();
+    std::atomic<size_t> subscribed{0};
+    std::atomic<size_t> received{0};
+    std::atomic<int64_t> lastReceivedNs{0};
+    client.set_open_handler([&](websocketpp::connection_hdl hdl) {
+        websocketpp::lib::error_code ec;
+        client.send(hdl, subscribe, websocketpp::frame::opcode::text, ec);
+    });
+    client.set_message_handler([&](websocketpp::connection_hdl, PlainClientType::message_ptr msg) {
+        if (msg->get_payload().compare(0, 40, "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\"") == 0) {
+            received.fetch_add(1, std::memory_order_relaxed);
+            lastReceivedNs.store(nowNs(), std::memory_order_relaxed);
+        } else {
+            subscribed.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    for (size_t i = 0; i < clients; ++i) {
+        websocketpp::lib::error_code ec;
+        auto con = client.get_connection("ws://127.0.0.1:" + port, ec);
+        if (ec) break;
+        client.connect(con);
+    }
+    std::thread clientThread([&client]() { client.run(); });
+
+    auto deadline = Clock::now() + std::chrono::seconds(30);
+    while (subscribed.load() < clients && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    size_t connected = subscribed.load();
+
+    int64_t startNs = nowNs();
+    for (const auto& message : feed) {
+        server.injectFrame(message);
+    }
+    size_t expected = connected * feed.size();
+    deadline = Clock::now() + std::chrono::seconds(60);
+    while (received.load() < expected && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    double sec = std::max<int64_t>(1, lastReceivedNs.load() - startNs) / 1e9;
+
+    // The stalled client connected first, so it has the lowest id.
+    WebSocketServer::ClientStats slow;
+    for (const auto& stats : server.clientStats()) {
+        if (slow.id == 0 || stats.id < slow.id) slow = stats;
+    }
+    uint64_t disconnects = server.slowDisconnects();
+
+    client.stop();
+    clientThread.join();
+    boost::system::error_code ignored;
+    stalled.close(ignored);
+    server.stop();
+    serverThread.join();
+    std::cout.rdbuf(savedCout);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    report("[BENCH] slow-consumer " + std::string(toString(policy.mode)) + (conflatedClient ? " (conflated client)" : "") + ": " + std::to_string(connected) +
+           " clients got " + std::to_string(received.load()) + "/" + std::to_string(expected) + " (" +
+           std::to_string(static_cast<uint64_t>(received.load() / sec)) + " msg/s)");
+    if (disconnects > 0) {
+        report("[BENCH] slow-consumer stalled client disconnected");
+    } else {
+        report("[BENCH] slow-consumer stalled client: max " + std::to_string(slow.maxBufferedBytes) +
+               " B buffered, " + std::to_string(slow.pendingFrames) + " pending, " + std::to_string(slow.dropped) +
+               " dropped, " + std::to_string(slow.conflated) + " conflated");
+    }
+    report("[BENCH] slow-consumer max RSS " + std::to_string(usage.ru_maxrss / 1024) + " MB");
+    return received.load() == expected ? 0 : 1;
+}
+
+// A client with conflated delivery subscribed to a book and a trades channel,
+// under the conflate slow-consumer policy. Books are conflated into
+// snapshots, but trades have none to resend: every injected trade must
+// still reach the client.
+// usage: conflated-trades [trades] [port]
+int benchConflatedTrades(const std::vector<std::string>& args) {
+    size_t trades = args.size() > 0 ? std::stoul(args[0]) : 1000;
+    std::string port = args.size() > 1 ? args[1] : "9450";
+
+    const std::string channel = "trades.SYN-0.100ms";
+    const std::string subscribe = "{\"id\":1,\"method\":\"subscribe\",\"params\":{\"channels\":"
+                                  "[\"book.SYN-0.100ms\",\"" + channel + "\"],\"delivery\":\"conflated\"}}";
+
+    std::ofstream devNull("/dev/null");
+    std::streambuf* savedCout = std::cout.rdbuf(devNull.rdbuf());
+
+    WebSocketServer server;
+    BackpressurePolicy policy;
+    policy.mode = BackpressurePolicy::Mode::Conflate;
+    server.setBackpressurePolicy(policy);
+    std::thread serverThread([&server, &port]() { server.serve(static_cast<uint16_t>(std::stoi(port)), 2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    PlainClientType client;
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.clear_error_channels(websocketpp::log::elevel::all);
+    client.init_asio();
+    std::atomic<bool> subscribed{false};
+    std::atomic<size_t> received{0};
+    client.set_open_handler([&](websocketpp::connection_hdl hdl) {
+        websocketpp::lib::error_code ec;
+        client.send(hdl, subscribe, websocketpp::frame::opcode::text, ec);
+    });
+    client.set_message_handler([&](websocketpp::connection_hdl, PlainClientType::message_ptr msg) {
+        const std::string& payload = msg->get_payload();
+        if (payload.find("\"method\":\"subscription\"") == std::string::npos) {
+            subscribed = true;
+        } else if (payload.find(channel) != std::string::npos) {
+            received.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    websocketpp::lib::error_code ec;
+    auto con = client.get_connection("ws://127.0.0.1:" + port, ec);
+    if (!ec) client.connect(con);
+    std::thread clientThread([&client]() { client.run(); });
+
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (!subscribed.load() && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    for (size_t i = 0; i < trades; ++i) {
+        json trade = {{"trade_seq", int64_t(i + 1)}, {"trade_id", "SYN-" + std::to_string(i + 1)},
+                      {"timestamp", int64_t(1700000000000 + i)}, {"price", 1000.0 + (i % 10) * 0.5},
+                      {"amount", 10.0}, {"direction", i % 2 ? "sell" : "buy"}, {"instrument_name", "SYN-0"}};
+        server.injectFrame(json({{"jsonrpc", "2.0"}, {"method", "subscription"},
+                                 {"params", {{"channel", channel}, {"data", json::array({trade})}}}}).dump());
+    }
+    deadline = Clock::now() + std::chrono::seconds(10);
+    while (received.load() < trades && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    client.stop();
+    clientThread.join();
+    server.stop();
+    serverThread.join();
+    std::cout.rdbuf(savedCout);
+
+    report("[BENCH] conflated-trades: conflated client got " + std::to_string(received.load()) + "/" +
+           std::to_string(trades) + " trade notifications" + (subscribed.load() ? "" : " (never subscribed)"));
+    return received.load() == trades ? 0 : 1;
+}
+
+// One notification of the replayed stream: when it reaches us and the
+// exchange events (book changes) it carries.
+struct TimedFrame {
+    int64_t publishNs = 0;
+    std::string payload;
+    std::vector<int64_t> eventNs;
+};
+
+// Folds a later level change into an earlier one within the same interval.
+// Returns false when the two cancel out (a level that came and went).
+bool mergeLevel(LevelUpdate& earlier, const LevelUpdate& later) {
+    BookAction action = later.action;
+    if (earlier.action == BookAction::New && later.action == BookAction::Delete) return false;
+    if (earlier.action == BookAction::New) action = BookAction::New;
+    else if (earlier.action == BookAction::Delete && later.action == BookAction::New) action = BookAction::Change;
+    earlier = LevelUpdate{action, later.price, later.amount};
+    return true;
+}
+
+// Re-publishes a raw book stream the way Deribit's book.<instrument>.100ms
+// channel does: per instrument, the changes of each 100 ms interval merged
+// into one notification sent at the end of the interval. Snapshots pass
+// through as they are.
+std::vector<TimedFrame> aggregate100ms(const std::vector<TimedFrame>& raw) {
+    constexpr int64_t kIntervalNs = 100000000;
+    struct Pending {
+        std::string channel;
+        std::string instrument;
+        int64_t intervalEnd = 0;
+        int64_t prevChangeId = 0;
+        int64_t changeId = 0;
+        int64_t timestamp = 0;
+        std::map<double, LevelUpdate> bids, asks;
+        std::vector<int64_t> eventNs;
+    };
+    std::map<std::string, Pending> pending;
+    std::vector<TimedFrame> out;
+
+    auto levels = [](const std::map<double, LevelUpdate>& side) {
+        json array = json::array();
+        for (const auto& level : side) {
+            const char* action = level.second.action == BookAction::New ? "new"
+                               : level.second.action == BookAction::Change ? "change" : "delete";
+            array.push_back({action, level.second.price, level.second.amount});
+        }
+        return array;
+    };
+    auto flush = [&](Pending& p) {
+        if (p.eventNs.empty()) return;
+        json data = {{"type", "change"}, {"instrument_name", p.instrument}, {"change_id", p.changeId},
+                     {"prev_change_id", p.prevChangeId}, {"timestamp", p.timestamp},
+                     {"bids", levels(p.bids)}, {"asks", levels(p.asks)}};
+        TimedFrame frame;
+        frame.publishNs = p.intervalEnd;
+        frame.payload = json({{"jsonrpc", "2.0"}, {"method", "subscription"},
+                              {"params", {{"channel", p.channel}, {"data", std::move(data)}}}}).dump();
+        frame.eventNs = std::move(p.eventNs);
+        out.push_back(std::move(frame));
+        p.eventNs.clear();
+        p.bids.clear();
+        p.asks.clear();
+    };
+    auto merge = [](std::map<double, LevelUpdate>& side, const std::vector<LevelUpdate>& updates) {
+        for (const auto& update : updates) {
+            auto it = side.find(update.price);
+            if (it == side.end()) side.emplace(update.price, update);
+            else if (!mergeLevel(it->second, update)) side.erase(it);
+        }
+    };
+
+    FeedDecoder decoder;
+    std::string channel;
+    BookUpdate update;
+    for (const auto& frame : raw) {
+        if (decoder.decode(frame.payload, channel, update) != FeedDecoder::Kind::Book) continue;
+        Pending& p = pending[update.instrument];
+        if (p.intervalEnd != 0 && frame.publishNs >= p.intervalEnd) flush(p);
+
+        if (update.snapshot) {
+            flush(p);
+            out.push_back(frame);
+            p.intervalEnd = 0;
+            p.changeId = update.changeId;
+            continue;
+        }
+        if (p.eventNs.empty()) {
+            p.channel = channel.substr(0, channel.rfind('.')) + ".100ms";
+            p.instrument = update.instrument;
+            p.intervalEnd = (frame.publishNs / kIntervalNs + 1) * kIntervalNs;
+            p.prevChangeId = update.prevChangeId;
+        }
+        p.changeId = update.changeId;
+        p.timestamp = update.timestamp;
+        merge(p.bids, update.bids);
+        merge(p.asks, update.asks);
+        p.eventNs.push_back(frame.eventNs.front());
+    }
+    for (auto& entry : pending) flush(entry.second);
+
+    std::stable_sort(out.begin(), out.end(), [](const TimedFrame& a, const TimedFrame& b) {
+        return a.publishNs < b.publishNs;
+    });
+    return out;
+}
+
+// Event-to-book latency of the same book changes delivered on a raw channel
+// vs the 100 ms aggregated one: how long after each change the local book
+// reflects it (waiting for the interval to close, plus the measured feed
+// dispatch). Runs on a capture of book.*.raw channels (record one with
+// BOOK_INTERVAL=raw FEED_CAPTURE=...), or on the synthetic feed with
+// exponential inter-arrival times. Also checks that both end in the same books.
+// usage: book-interval [capture] [--changes N] [--rate events/s] [--channels N]
+int benchBookInterval(const std::vector<std::string>& args) {
+    std::string capturePath;
+    size_t changes = 50000, channels = 10;
+    double rate = 1000;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--changes" && i + 1 < args.size()) changes = std::stoul(args[++i]);
+        else if (args[i] == "--rate" && i + 1 < args.size()) rate = std::stod(args[++i]);
+        else if (args[i] == "--channels" && i + 1 < args.size()) channels = std::max<size_t>(1, std::stoul(args[++i]));
+        else capturePath = args[i];
+    }
+
+    std::vector<TimedFrame> raw;
+    if (!capturePath.empty()) {
+        FeedCaptureReader reader;
+        if (!reader.open(capturePath)) return 1;
+        FeedCaptureReader::Frame frame;
+        while (reader.next(frame)) {
+            if (frame.payload.find("\"book.") == std::string_view::npos) continue;
+            raw.push_back(TimedFrame{frame.receivedWallNs, std::string(frame.payload), {frame.receivedWallNs}});
+        }
+    } else {
+        std::mt19937 rng(7);
+        std::exponential_distribution<double> gap(rate);
+        double t = 1e9;
+        for (auto& message : syntheticBookFeed(channels, changes)) {
+            t += gap(rng) * 1e9;
+            int64_t ns = static_cast<int64_t>(t);
+            raw.push_back(TimedFrame{ns, std::move(message), {ns}});
+        }
+    }
+    std::vector<TimedFrame> aggregated = aggregate100ms(raw);
+
+    // Books as each stream leaves them, for the consistency check
+    auto finalBooks = [](const std::vector<TimedFrame>& stream) {
+        std::map<std::string, OrderBook> books;
+        FeedDecoder decoder;
+        std::string channel;
+        BookUpdate update;
+        for (const auto& frame : stream) {
+            if (decoder.decode(frame.payload, channel, update) != FeedDecoder::Kind::Book) continue;
+            books.try_emplace(update.instrument, update.instrument).first->second.apply(update);
+        }
+        return books;
+    };
+
+    auto run = [&](const std::string& label, const std::vector<TimedFrame>& stream) {
+        WebSocketServer server;
+        std::vector<double> latencyUs;
+        size_t events = 0;
+        for (const auto& frame : stream) {
+            int64_t start = nowNs();
+            server.dispatchFeedMessage(frame.payload);
+            int64_t dispatchNs = nowNs() - start;
+            for (int64_t eventNs : frame.eventNs) {
+                latencyUs.push_back((frame.publishNs - eventNs + dispatchNs) / 1e3);
+            }
+            events += frame.eventNs.size();
+        }
+        report("[BENCH] book-interval " + label + ": " + std::to_string(stream.size()) + " messages, " +
+               std::to_string(events) + " events, event-to-book " + summarize(latencyUs, "us"));
+    };
+
+    run("raw", raw);
+    run("100ms", aggregated);
+
+    auto rawBooks = finalBooks(raw);
+    auto aggregatedBooks = finalBooks(aggregated);
+    bool same = rawBooks.size() == aggregatedBooks.size();
+    for (const auto& entry : rawBooks) {
+        auto it = aggregatedBooks.find(entry.first);
+        same = same && it != aggregatedBooks.end() && sameBook(entry.second, it->second);
+    }
+    report(std::string("[BENCH] book-interval final books ") + (same ? "match" : "DIFFER"));
+    return same ? 0 : 1;
+}
+
+// Drops the Deribit session of a WebSocketServer connected to an in-process
+// mock exchange, `cycles` times, and reports how long after each drop the
+// server is open, authenticated and resubscribed again. It subscribes raw
+// book and trades channels, which need the authenticated session.
+// usage: ws-reconnect [cycles] [mock-port]
+int benchWsReconnect(const std::vector<std::string>& args) {
+    int cycles = args.size() > 0 ? std::max(1, std::stoi(args[0])) : 10;
+    std::string mockPort = args.size() > 1 ? args[1] : "8460";
+
+    MockExchange::Config config;
+    config.updatesPerSecond = 50;
+    config.instruments = {"BTC-PERPETUAL"};
+    MockExchange exchange(config);
+    std::thread exchangeThread([&exchange, &mockPort]() { exchange.run(static_cast<uint16_t>(std::stoi(mockPort))); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    LatencyHistogram& toOpen = latency("ws reconnect_to_open");
+    LatencyHistogram& toAuthenticated = latency("ws reconnect_to_authenticated");
+    LatencyHistogram& toResubscribed = latency("ws reconnect_to_resubscribed");
+    LatencyHistogram& subscribed = latency("ws private/subscribe round_trip");
+
+    WebSocketServer server("wss://127.0.0.1:" + mockPort + "/ws/api/v2");
+    server.setCredentials("bench-client", "bench-secret");
+    server.setInstruments({"BTC-PERPETUAL"});
+    server.setFeedChannels("raw", true);
+    std::thread serverThread([&server]() { server.run(9510); });
+
+    auto waitFor = [](const std::function<bool()>& done, std::chrono::seconds timeout) {
+        auto deadline = Clock::now() + timeout;
+        while (!done() && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return done();
+    };
+
+    int completed = 0;
+    if (waitFor([&]() { return subscribed.count() > 0; }, std::chrono::seconds(10))) {
+        for (; completed < cycles; ++completed) {
+            uint64_t before = toResubscribed.count();
+            exchange.dropConnections();
+            if (!waitFor([&]() { return toResubscribed.count() > before; }, std::chrono::seconds(15))) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    } else {
+        std::cerr << "[ERROR] Server never subscribed on the mock exchange" << std::endl;
+    }
+
+    server.stop();
+    serverThread.join();
+    exchange.stop();
+    exchangeThread.join();
+
+    auto ms = [](const LatencyHistogram& h) {
+        return "p50 " + std::to_string(h.percentile(50) / 1e6) + " ms, p99 " + std::to_string(h.percentile(99) / 1e6) +
+               " ms, max " + std::to_string(h.max() / 1e6) + " ms";
+    };
+    report("[BENCH] ws-reconnect " + std::to_string(completed) + "/" + std::to_string(cycles) + " recoveries");
+    report("[BENCH] ws-reconnect drop to open: " + ms(toOpen));
+    report("[BENCH] ws-reconnect drop to authenticated: " + ms(toAuthenticated));
+    report("[BENCH] ws-reconnect drop to resubscribed: " + ms(toResubscribed));
+    return completed == cycles ? 0 : 1;
+}
+
+const std::map<std::string, std::function<int(const std::vector<std::string>&)>>& benchmarks() {
+    static const std::map<std::string, std::function<int(const std::vector<std::string>&)>> table = {
+        {"http-reuse", benchHttpReuse},
+        {"ws-orders", benchWsOrders},
+        {"book-replay", benchBookReplay},
+        {"book-resync", benchBookResync},
+        {"parse-compare", benchParseCompare},
+        {"fanout", benchFanout},
+        {"dispatch-stress", benchDispatchStress},
+        {"log-overhead", benchLogOverhead},
+        {"make-capture", benchMakeCapture},
+        {"feed-replay", benchFeedReplay},
+        {"rest-batch", benchRestBatch},
+        {"order-alloc", benchOrderAlloc},
+        {"server-scaling", benchServerScaling},
+        {"slow-consumer", benchSlowConsumer},
+        {"conflated-trades", benchConflatedTrades},
+        {"book-interval", benchBookInterval},
+        {"ws-reconnect", benchWsReconnect},
+    };
+    return table;
+}
+
+} // namespace
+
+int runBenchmark(const std::string& name, const std::vector<std::string>& args) {
+    const auto& table = benchmarks();
+    auto it = table.find(name);
+    if (it == table.end()) {
+        std::cerr << "Unknown benchmark '" << name << "'. Available:";
+        for (const auto& entry : table) std::cerr << " " << entry.first;
+        std::cerr << std::endl;
+        return 1;
+    }
+    return it->second(args);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Entry point for `main --bench <name> [args...]`.
+// Every benchmark prints its results and appends them to benchmark.log.
+int runBenchmark(const std::string& name, const std::vector<std::string>& args);
@@ -0,0 +1,94 @@
+#include "book_sync.hpp"
+
+BookSync::BookSync(std::string channel, std::string instrument, ResyncRequest requestResync)
+    : channel_(std::move(channel)),
+      book_(std::move(instrument)),
+      requestResync_(std::move(requestResync)) {}
+
+bool BookSync::onUpdate(const BookUpdate& update) {
+    if (update.snapshot) {
+        // Anything buffered is older than a snapshot from the same stream.
+        book_.apply(update);
+        buffered_.clear();
+        markLive();
+        return true;
+    }
+
+    switch (state_) {
+    case State::Live:
+        if (update.prevChangeId == book_.changeId()) {
+            book_.apply(update);
+            return true;
+        }
+        if (update.changeId <= book_.changeId()) {
+            return false;  // duplicate or reordered, already applied
+        }
+        startResync(update);
+        return false;
+
+    case State::AwaitingSnapshot:
+        startResync(update);
+        return false;
+
+    case State::Resyncing:
+        if (buffered_.size() >= kMaxBuffered) {
+            // The snapshot is taking too long; start over with a newer one.
+            buffered_.clear();
+            requestResync_(book_.instrument());
+        }
+        buffered_.push_back(update);
+        return false;
+    }
+    return false;
+}
+
+bool BookSync::onSnapshot(const BookUpdate& snapshot) {
+    if (state_ == State::Live) {
+        return false;  // the stream already resynced on its own
+    }
+
+    book_.apply(snapshot);
+    if (!replayBuffered()) {
+        requestResync_(book_.instrument());
+        return false;
+    }
+    markLive();
+    return true;
+}
+
+void BookSync::startResync(const BookUpdate& update) {
+    state_ = State::Resyncing;
+    ++gaps_;
+    gapDetectedAt_ = std::chrono::steady_clock::now();
+    buffered_.clear();
+    buffered_.push_back(update);
+    requestResync_(book_.instrument());
+}
+
+bool BookSync::replayBuffered() {
+    size_t i = 0;
+    for (; i < buffered_.size(); ++i) {
+        const BookUpdate& update = buffered_[i];
+        if (update.changeId <= book_.changeId()) {
+            continue;  // already contained in the snapshot
+        }
+        if (update.prevChangeId > book_.changeId()) {
+            // Snapshot is older than the buffered stream; keep the rest for the next one.
+            buffered_.erase(buffered_.begin(), buffered_.begin() + i);
+            return false;
+        }
+        // Levels carry absolute amounts, so a delta straddling the snapshot
+        // change_id still leaves the book consistent.
+        book_.apply(update);
+    }
+    buffered_.clear();
+    return true;
+}
+
+void BookSync::markLive() {
+    if (state_ == State::Resyncing) {
+        lastRecoveryMs_ = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - gapDetectedAt_).count();
+    }
+    state_ = State::Live;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "order_book.hpp"
+
+// Keeps one OrderBook consistent with a book.* subscription.
+//
+// Every change must chain onto the previous one (prev_change_id == the book's
+// change_id). On a gap the book is frozen, a fresh snapshot is requested and
+// later deltas are buffered; once the snapshot arrives the buffer is replayed
+// on top of it and the book goes live again without touching the connection.
+class BookSync {
+public:
+    enum class State { AwaitingSnapshot, Live, Resyncing };
+
+    // Called with the instrument whenever a new snapshot is needed.
+    using ResyncRequest = std::function<void(const std::string& instrument)>;
+
+    BookSync(std::string channel, std::string instrument, ResyncRequest requestResync);
+
+    // Feeds one update from the subscription. Returns true when the book
+    // changed and is consistent, i.e. the update is safe to publish.
+    bool onUpdate(const BookUpdate& update);
+
+    // Feeds an out-of-band snapshot (REST get_order_book). Returns true when
+    // the book is live again after replaying the buffered deltas.
+    bool onSnapshot(const BookUpdate& snapshot);
+
+    const OrderBook& book() const { return book_; }
+    const std::string& channel() const { return channel_; }
+    State state() const { return state_; }
+    bool live() const { return state_ == State::Live; }
+
+    uint64_t gaps() const { return gaps_; }
+    size_t buffered() const { return buffered_.size(); }
+    // Gap detection to live again, for the most recent recovery.
+    double lastRecoveryMs() const { return lastRecoveryMs_; }
+
+    // Drops buffered deltas beyond this and asks for another snapshot.
+    static constexpr size_t kMaxBuffered = 4096;
+
+private:
+    void startResync(const BookUpdate& update);
+    bool replayBuffered();
+    void markLive();
+
+    std::string channel_;
+    OrderBook book_;
+    ResyncRequest requestResync_;
+    State state_ = State::AwaitingSnapshot;
+
+    std::vector<BookUpdate> buffered_;
+    std::chrono::steady_clock::time_point gapDetectedAt_;
+    uint64_t gaps_ = 0;
+    double lastRecoveryMs_ = 0;
+};
@@ -0,0 +1,31 @@
+#include "client_session.hpp"
+#include "utils.hpp"
+#include <iostream>
+
+const char* toString(BackpressurePolicy::Mode mode) {
+    switch (mode) {
+    case BackpressurePolicy::Mode::DropOldest: return "drop-oldest";
+    case BackpressurePolicy::Mode::Conflate: return "conflate";
+    case BackpressurePolicy::Mode::Disconnect: return "disconnect";
+    }
+    return "conflate";
+}
+
+bool parseBackpressureMode(const std::string& text, BackpressurePolicy::Mode& mode) {
+    if (text == "drop-oldest") mode = BackpressurePolicy::Mode::DropOldest;
+    else if (text == "conflate") mode = BackpressurePolicy::Mode::Conflate;
+    else if (text == "disconnect") mode = BackpressurePolicy::Mode::Disconnect;
+    else return false;
+    return true;
+}
+
+BackpressurePolicy BackpressurePolicy::fromEnv() {
+    BackpressurePolicy policy;
+    std::string mode = getEnvValueOr("DOWNSTREAM_POLICY", "conflate");
+    if (!parseBackpressureMode(mode, policy.mode)) {
+        std::cerr << "[CONFIG] Unknown DOWNSTREAM_POLICY '" << mode << "', using conflate" << std::endl;
+    }
+    policy.maxBufferedBytes = static_cast<size_t>(getEnvNumberOr("DOWNSTREAM_MAX_BUFFERED_KB", 4096, 1)) * 1024;
+    policy.maxPendingFrames = static_cast<size_t>(getEnvNumberOr("DOWNSTREAM_MAX_PENDING", 1024, 1));
+    return policy;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <websocketpp/common/connection_hdl.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+
+// What the server does with a downstream client whose socket is not keeping
+// up, i.e. whose websocketpp send buffer holds more than maxBufferedBytes.
+//
+//   drop-oldest  later frames wait in a short queue of our own; when that is
+//                full its oldest frame is dropped (the client sees a gap in
+//                change_id)
+//   conflate     book deltas for the client are skipped until its buffer has
+//                drained to half the limit, then it gets one fresh snapshot
+//                per skipped channel and deltas resume. Channels without a
+//                book (trades) have no snapshot and fall back to drop-oldest
+//   disconnect   the connection is closed (1013 "try again later")
+//
+// Read from the environment by fromEnv(): DOWNSTREAM_POLICY (default
+// conflate), DOWNSTREAM_MAX_BUFFERED_KB (4096), DOWNSTREAM_MAX_PENDING (1024).
+struct BackpressurePolicy {
+    enum class Mode { DropOldest, Conflate, Disconnect };
+
+    Mode mode = Mode::Conflate;
+    size_t maxBufferedBytes = 4 << 20;
+    size_t maxPendingFrames = 1024;  // drop-oldest only
+
+    static BackpressurePolicy fromEnv();
+};
+
+const char* toString(BackpressurePolicy::Mode mode);
+bool parseBackpressureMode(const std::string& text, BackpressurePolicy::Mode& mode);
+
+// A connected downstream client. With a multi-threaded server, sends to it
+// go through its own strand: its messages stay in order while different
+// clients are written from different threads.
+struct ClientSession {
+    using Frame = websocketpp::config::asio::message_type::ptr;
+
+    ClientSession(websocketpp::connection_hdl h, boost::asio::io_service& io, uint64_t clientId, std::string address)
+        : hdl(std::move(h)), strand(io), id(clientId), remote(std::move(address)) {}
+
+    websocketpp::connection_hdl hdl;
+    boost::asio::io_service::strand strand;
+    const uint64_t id;
+    const std::string remote;
+
+    // Outbound state, only touched from the strand that sends to the client
+    std::deque<Frame> pending;                // drop-oldest backlog
+    std::map<std::string, bool> staleChannels;  // conflated: channel -> snapshot requested
+    bool closing = false;
+
+    // Conflated delivery, chosen by the client ("delivery": "conflated" on
+    // subscribe): it never gets deltas, only the latest book of each channel
+    // whenever its socket has nothing left to write. Memory per client stays
+    // at one stale flag per book channel however fast the feed runs. Trades
+    // have no book to resend and are still delivered one by one.
+    std::atomic<bool> conflating{false};
+
+    // Metrics, readable from any thread
+    std::atomic<size_t> bufferedBytes{0};     // websocketpp send buffer at the last send
+    std::atomic<size_t> maxBufferedBytes{0};
+    std::atomic<size_t> pendingFrames{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> conflated{0};
+    // Set while pending or staleChannels is non-empty, so the server's
+    // periodic flush only visits clients that need it.
+    std::atomic<bool> backlogged{false};
+
+    void noteBuffered(size_t bytes) {
+        bufferedBytes.store(bytes, std::memory_order_relaxed);
+        if (bytes > maxBufferedBytes.load(std::memory_order_relaxed)) {
+            maxBufferedBytes.store(bytes, std::memory_order_relaxed);
+        }
+    }
+};
+using ClientPtr = std::shared_ptr<ClientSession>;
@@ -0,0 +1,103 @@
+#include "deribit_config.hpp"
+#include "utils.hpp"
+#include "../json.hpp"
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Target {
+    const char* name;
+    const char* restUrl;
+    const char* wsUrl;
+    bool verifyPeer;
+};
+
+const Target kTargets[] = {
+    {"test", "https://test.deribit.com", "wss://test.deribit.com/ws/api/v2", true},
+    {"prod", "https://www.deribit.com", "wss://www.deribit.com/ws/api/v2", true},
+    {"mock", "https://127.0.0.1:8443", "wss://127.0.0.1:8443/ws/api/v2", false},
+};
+
+RequestPolicy parsePolicy(const json& j, RequestPolicy policy) {
+    policy.connectTimeoutMs = j.value("connect_timeout_ms", policy.connectTimeoutMs);
+    policy.timeoutMs = j.value("timeout_ms", policy.timeoutMs);
+    policy.reuseConnection = j.value("reuse", policy.reuseConnection);
+    policy.maxIdleSeconds = j.value("max_idle_s", policy.maxIdleSeconds);
+    policy.http2 = j.value("http2", policy.http2);
+    return policy;
+}
+
+void loadEndpointFile(const std::string& path, DeribitConfig& config) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR] Could not open endpoint config " << path << std::endl;
+        return;
+    }
+
+    try {
+        json j = json::parse(file);
+        config.restUrl = j.value("rest_url", config.restUrl);
+        config.wsUrl = j.value("ws_url", config.wsUrl);
+        config.verifyPeer = j.value("verify_peer", config.verifyPeer);
+        if (j.contains("default")) config.defaultPolicy = parsePolicy(j["default"], config.defaultPolicy);
+        if (j.contains("endpoints")) {
+            for (const auto& entry : j["endpoints"].items()) {
+                std::string path = entry.key();
+                if (path.compare(0, 1, "/") != 0) path = "/api/v2/" + path;
+                // Unset fields inherit from the default policy
+                config.endpoints[path] = parsePolicy(entry.value(), config.defaultPolicy);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Invalid endpoint config " << path << ": " << e.what() << std::endl;
+    }
+}
+
+} // namespace
+
+const DeribitConfig& DeribitConfig::instance() {
+    static const DeribitConfig config = load();
+    return config;
+}
+
+DeribitConfig DeribitConfig::load() {
+    DeribitConfig config;
+    config.name = getEnvValueOr("DERIBIT_ENV", "test");
+
+    const Target* target = &kTargets[0];
+    for (const auto& candidate : kTargets) {
+        if (config.name == candidate.name) target = &candidate;
+    }
+    if (config.name != target->name) {
+        std::cerr << "[ERROR] Unknown DERIBIT_ENV '" << config.name << "', using test" << std::endl;
+        config.name = target->name;
+    }
+    config.restUrl = target->restUrl;
+    config.wsUrl = target->wsUrl;
+    config.verifyPeer = target->verifyPeer;
+
+    std::string endpointFile = getEnvValueOr("DERIBIT_ENDPOINTS", "");
+    if (!endpointFile.empty()) loadEndpointFile(endpointFile, config);
+
+    config.restUrl = getEnvValueOr("DERIBIT_REST_URL", config.restUrl);
+    config.wsUrl = getEnvValueOr("DERIBIT_WS_URL", config.wsUrl);
+    std::string verify = getEnvValueOr("DERIBIT_TLS_VERIFY", "");
+    if (!verify.empty()) config.verifyPeer = verify != "0";
+    return config;
+}
+
+void DeribitConfig::apply() const {
+    HttpPool& pool = HttpPool::instance();
+    pool.setVerifyPeer(verifyPeer);
+    pool.setDefaultPolicy(defaultPolicy);
+    for (const auto& entry : endpoints) pool.setPolicy(entry.first, entry.second);
+}
+
+void DeribitConfig::print() const {
+    std::cout << "[CONFIG] " << name << ": REST " << restUrl << ", WS " << wsUrl
+              << (verifyPeer ? "" : ", TLS verification off") << ", " << endpoints.size()
+              << " endpoint policies" << std::endl;
+}
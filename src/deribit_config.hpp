@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include "http_pool.hpp"
+
+// Where the client talks to, resolved once from .env / the environment.
+//
+// DERIBIT_ENV picks a base target:
+//   test (default)  https://test.deribit.com,  wss://test.deribit.com/ws/api/v2
+//   prod            https://www.deribit.com,   wss://www.deribit.com/ws/api/v2
+//   mock            https://127.0.0.1:8443,    wss://127.0.0.1:8443/ws/api/v2, no TLS verification
+// DERIBIT_REST_URL, DERIBIT_WS_URL and DERIBIT_TLS_VERIFY=0|1 override the
+// target, e.g. for a colocated gateway.
+//
+// DERIBIT_ENDPOINTS names an optional JSON file with transport policies:
+//   {"rest_url": "...", "ws_url": "...", "verify_peer": true,
+//    "default": {"connect_timeout_ms": 1000, "timeout_ms": 5000},
+//    "endpoints": {"private/buy": {"timeout_ms": 500, "reuse": true, "max_idle_s": 30, "http2": true}}}
+// Endpoint keys may be given with or without the "/api/v2/" prefix. URLs in
+// the file take precedence over DERIBIT_ENV but not over the URL variables.
+struct DeribitConfig {
+    std::string name = "test";
+    std::string restUrl;
+    std::string wsUrl;
+    bool verifyPeer = true;
+    RequestPolicy defaultPolicy;
+    std::map<std::string, RequestPolicy> endpoints;  // keyed by full path
+
+    static const DeribitConfig& instance();
+    static DeribitConfig load();
+
+    // "/api/v2/private/buy" -> restUrl + "/api/v2/private/buy"
+    std::string url(const std::string& path) const { return restUrl + path; }
+
+    // Pushes verification and endpoint policies into HttpPool.
+    void apply() const;
+    void print() const;
+};
@@ -0,0 +1,138 @@
+#include "feed_capture.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'R', 'B', 'C', 'A', 'P', '0', '1'};
+constexpr size_t kRecordHeader = sizeof(int64_t) + sizeof(uint32_t);
+
+} // namespace
+
+FeedCaptureWriter::~FeedCaptureWriter() {
+    close();
+}
+
+bool FeedCaptureWriter::open(const std::string& path) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "[ERROR] Could not open capture file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (!reserve(sizeof(kMagic))) {
+        close();
+        return false;
+    }
+    std::memcpy(map_, kMagic, sizeof(kMagic));
+    used_ = sizeof(kMagic);
+    records_ = 0;
+    return true;
+}
+
+bool FeedCaptureWriter::reserve(size_t bytes) {
+    if (used_ + bytes <= mapped_) return true;
+
+    size_t size = mapped_;
+    while (size < used_ + bytes) size += kGrowBytes;
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        std::cerr << "[ERROR] Could not grow capture file: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    void* map = map_ ? ::mremap(map_, mapped_, size, MREMAP_MAYMOVE)
+                     : ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "[ERROR] Could not map capture file: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    map_ = static_cast<char*>(map);
+    mapped_ = size;
+    return true;
+}
+
+void FeedCaptureWriter::append(int64_t receivedWallNs, std::string_view payload) {
+    if (!map_ || !reserve(kRecordHeader + payload.size())) return;
+
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    char* out = map_ + used_;
+    std::memcpy(out, &receivedWallNs, sizeof(receivedWallNs));
+    std::memcpy(out + sizeof(receivedWallNs), &length, sizeof(length));
+    std::memcpy(out + kRecordHeader, payload.data(), payload.size());
+    used_ += kRecordHeader + payload.size();
+    ++records_;
+}
+
+void FeedCaptureWriter::close() {
+    if (map_) {
+        ::munmap(map_, mapped_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        // Drop the unused tail of the last growth step
+        if (::ftruncate(fd_, static_cast<off_t>(used_)) != 0) {
+            std::cerr << "[ERROR] Could not trim capture file: " << std::strerror(errno) << std::endl;
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+    mapped_ = 0;
+    used_ = 0;
+}
+
+FeedCaptureReader::~FeedCaptureReader() {
+    if (map_) ::munmap(const_cast<char*>(map_), size_);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool FeedCaptureReader::open(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd_ < 0 || ::fstat(fd_, &st) != 0) {
+        std::cerr << "[ERROR] Could not open capture file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ < sizeof(kMagic)) {
+        std::cerr << "[ERROR] " << path << " is not a feed capture" << std::endl;
+        return false;
+    }
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "[ERROR] Could not map capture file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    map_ = static_cast<const char*>(map);
+    ::madvise(map, size_, MADV_SEQUENTIAL);
+
+    if (std::memcmp(map_, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << "[ERROR] " << path << " is not a feed capture" << std::endl;
+        return false;
+    }
+    offset_ = sizeof(kMagic);
+    return true;
+}
+
+bool FeedCaptureReader::next(Frame& frame) {
+    if (!map_ || offset_ + kRecordHeader > size_) return false;
+
+    uint32_t length;
+    std::memcpy(&frame.receivedWallNs, map_ + offset_, sizeof(frame.receivedWallNs));
+    std::memcpy(&length, map_ + offset_ + sizeof(frame.receivedWallNs), sizeof(length));
+    // A zeroed record is the unwritten tail of a capture that was not closed
+    if ((frame.receivedWallNs == 0 && length == 0) || offset_ + kRecordHeader + length > size_) return false;
+
+    frame.payload = std::string_view(map_ + offset_ + kRecordHeader, length);
+    offset_ += kRecordHeader + length;
+    return true;
+}
+
+void FeedCaptureReader::rewind() {
+    offset_ = sizeof(kMagic);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Raw Deribit feed capture files.
+//
+// Layout: the 8-byte magic "DRBCAP01", then one record per inbound frame:
+//   int64  receive time (wall clock, ns)
+//   uint32 payload length
+//   payload bytes
+// Records are packed and host-endian. The file grows in large steps and is
+// trimmed on close; after a crash the zero-filled tail reads as end of file.
+
+class FeedCaptureWriter {
+public:
+    FeedCaptureWriter() = default;
+    ~FeedCaptureWriter();
+    FeedCaptureWriter(const FeedCaptureWriter&) = delete;
+    FeedCaptureWriter& operator=(const FeedCaptureWriter&) = delete;
+
+    // Truncates `path`. Returns false (and logs) if it cannot be mapped.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return map_ != nullptr; }
+
+    // Single writer: call from one thread only.
+    void append(int64_t receivedWallNs, std::string_view payload);
+    uint64_t records() const { return records_; }
+
+private:
+    bool reserve(size_t bytes);
+
+    static constexpr size_t kGrowBytes = size_t(64) << 20;
+
+    int fd_ = -1;
+    char* map_ = nullptr;
+    size_t mapped_ = 0;
+    size_t used_ = 0;
+    uint64_t records_ = 0;
+};
+
+class FeedCaptureReader {
+public:
+    struct Frame {
+        int64_t receivedWallNs;
+        std::string_view payload;  // points into the mapping
+    };
+
+    FeedCaptureReader() = default;
+    ~FeedCaptureReader();
+    FeedCaptureReader(const FeedCaptureReader&) = delete;
+    FeedCaptureReader& operator=(const FeedCaptureReader&) = delete;
+
+    bool open(const std::string& path);
+    bool next(Frame& frame);
+    void rewind();
+
+private:
+    int fd_ = -1;
+    const char* map_ = nullptr;
+    size_t size_ = 0;
+    size_t offset_ = 0;
+};
@@ -0,0 +1,175 @@
+#include "feed_decoder.hpp"
+
+using namespace simdjson;
+
+namespace {
+
+bool decodeAction(std::string_view action, BookAction& out) {
+    if (action == "new") out = BookAction::New;
+    else if (action == "change") out = BookAction::Change;
+    else if (action == "delete") out = BookAction::Delete;
+    else return false;
+    return true;
+}
+
+// [[action, price, amount], ...]
+bool decodeLevels(ondemand::value& value, std::vector<LevelUpdate>& out) {
+    out.clear();
+    ondemand::array levels;
+    if (value.get_array().get(levels)) return false;
+
+    for (auto levelResult : levels) {
+        ondemand::array level;
+        if (levelResult.get_array().get(level)) return false;
+
+        LevelUpdate update{};
+        size_t index = 0;
+        for (auto element : level) {
+            if (index == 0) {
+                std::string_view action;
+                if (element.get_string().get(action) || !decodeAction(action, update.action)) return false;
+            } else if (index == 1) {
+                if (element.get_double().get(update.price)) return false;
+            } else if (index == 2) {
+                if (element.get_double().get(update.amount)) return false;
+            } else {
+                return false;
+            }
+            ++index;
+        }
+        if (index != 3) return false;
+        out.push_back(update);
+    }
+    return true;
+}
+
+// Walks the "data" object once, in document order.
+bool decodeBook(ondemand::object& data, BookUpdate& out) {
+    out.snapshot = false;
+    out.prevChangeId = 0;
+    out.timestamp = 0;
+    bool hasChangeId = false, hasBids = false, hasAsks = false;
+
+    for (auto fieldResult : data) {
+        ondemand::field field;
+        std::string_view key;
+        if (std::move(fieldResult).get(field) || field.unescaped_key().get(key)) return false;
+        ondemand::value& value = field.value();
+
+        if (key == "type") {
+            std::string_view type;
+            if (value.get_string().get(type)) return false;
+            out.snapshot = type == "snapshot";
+        } else if (key == "instrument_name") {
+            std::string_view name;
+            if (value.get_string().get(name)) return false;
+            out.instrument.assign(name.data(), name.size());
+        } else if (key == "change_id") {
+            if (value.get_int64().get(out.changeId)) return false;
+            hasChangeId = true;
+        } else if (key == "prev_change_id") {
+            if (value.get_int64().get(out.prevChangeId)) return false;
+        } else if (key == "timestamp") {
+            if (value.get_int64().get(out.timestamp)) return false;
+        } else if (key == "bids") {
+            if (!decodeLevels(value, out.bids)) return false;
+            hasBids = true;
+        } else if (key == "asks") {
+            if (!decodeLevels(value, out.asks)) return false;
+            hasAsks = true;
+        }
+    }
+    return hasChangeId && hasBids && hasAsks;
+}
+
+// One element of a trades notification's "data" array
+bool decodeTrade(ondemand::object& data, TradeUpdate& out) {
+    out.tradeSeq = 0;
+    out.timestamp = 0;
+    out.direction = Direction::Zero;
+    bool hasPrice = false, hasAmount = false;
+
+    for (auto fieldResult : data) {
+        ondemand::field field;
+        std::string_view key;
+        if (std::move(fieldResult).get(field) || field.unescaped_key().get(key)) return false;
+        ondemand::value& value = field.value();
+
+        if (key == "instrument_name") {
+            std::string_view name;
+            if (value.get_string().get(name)) return false;
+            out.instrument.assign(name);
+        } else if (key == "trade_id") {
+            std::string_view id;
+            if (value.get_string().get(id)) return false;
+            out.tradeId.assign(id);
+        } else if (key == "trade_seq") {
+            if (value.get_int64().get(out.tradeSeq)) return false;
+        } else if (key == "timestamp") {
+            if (value.get_int64().get(out.timestamp)) return false;
+        } else if (key == "price") {
+            if (value.get_double().get(out.price)) return false;
+            hasPrice = true;
+        } else if (key == "amount") {
+            if (value.get_double().get(out.amount)) return false;
+            hasAmount = true;
+        } else if (key == "direction") {
+            std::string_view direction;
+            if (value.get_string().get(direction)) return false;
+            out.direction = direction == "buy" ? Direction::Buy : direction == "sell" ? Direction::Sell : Direction::Zero;
+        }
+    }
+    return hasPrice && hasAmount;
+}
+
+} // namespace
+
+FeedDecoder::Kind FeedDecoder::decode(const std::string& payload, std::string& channel, BookUpdate& update) {
+    // simdjson reads up to SIMDJSON_PADDING bytes past the end; websocketpp
+    // payloads usually have the spare capacity, otherwise copy once.
+    const char* data = payload.data();
+    size_t capacity = payload.capacity();
+    if (capacity < payload.size() + SIMDJSON_PADDING) {
+        padded_.reserve(payload.size() + SIMDJSON_PADDING);
+        padded_.assign(payload);
+        data = padded_.data();
+        capacity = padded_.capacity();
+    }
+
+    ondemand::document doc;
+    if (parser_.iterate(data, payload.size(), capacity).get(doc)) return Kind::Invalid;
+
+    std::string_view method;
+    if (doc["method"].get_string().get(method) || method != "subscription") return Kind::Control;
+
+    ondemand::object params;
+    std::string_view channelName;
+    if (doc["params"].get_object().get(params) || params["channel"].get_string().get(channelName)) {
+        return Kind::Invalid;
+    }
+    channel.assign(channelName.data(), channelName.size());
+
+    if (channelName.compare(0, 7, "trades.") == 0) {
+        ondemand::array tradeData;
+        if (params["data"].get_array().get(tradeData)) return Kind::Invalid;
+        return decodeTrades(tradeData) ? Kind::Trades : Kind::Invalid;
+    }
+    if (channelName.compare(0, 5, "book.") != 0) return Kind::Other;
+
+    ondemand::object bookData;
+    if (params["data"].get_object().get(bookData)) return Kind::Invalid;
+    return decodeBook(bookData, update) ? Kind::Book : Kind::Invalid;
+}
+
+bool FeedDecoder::decodeTrades(ondemand::array& data) {
+    size_t count = 0;
+    for (auto entry : data) {
+        ondemand::object trade;
+        if (entry.get_object().get(trade)) return false;
+        if (count == trades_.size()) trades_.emplace_back();
+        if (!decodeTrade(trade, trades_[count])) return false;
+        ++count;
+    }
+    trades_.resize(count);
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <simdjson.h>
+#include "order_book.hpp"
+#include "order_types.hpp"
+
+// One trade from a trades.<instrument>.* notification.
+struct TradeUpdate {
+    FixedString<32> instrument;
+    FixedString<32> tradeId;
+    int64_t tradeSeq = 0;
+    int64_t timestamp = 0;  // exchange time, ms
+    double price = 0;
+    double amount = 0;
+    Direction direction = Direction::Zero;
+};
+
+// Decodes Deribit "subscription" notifications with simdjson's on-demand API
+// straight into typed structs, without building a DOM. Everything else
+// (responses, errors, heartbeats) is reported as Control and left to the
+// nlohmann path, which is fine for those cold messages.
+class FeedDecoder {
+public:
+    enum class Kind {
+        Book,     // book.* notification, `update` filled
+        Trades,   // trades.* notification, see trades()
+        Other,    // notification on another channel, only `channel` filled
+        Control,  // not a subscription notification
+        Invalid   // malformed notification
+    };
+
+    Kind decode(const std::string& payload, std::string& channel, BookUpdate& update);
+
+    // Trades of the last Trades notification; entries are reused between calls.
+    const std::vector<TradeUpdate>& trades() const { return trades_; }
+
+private:
+    bool decodeTrades(simdjson::ondemand::array& data);
+
+    std::vector<TradeUpdate> trades_;
+    simdjson::ondemand::parser parser_;
+    std::string padded_;  // used when the payload has no room for simdjson's padding
+};
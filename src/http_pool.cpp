@@ -0,0 +1,211 @@
+#include "http_pool.hpp"
+#include "utils.hpp"
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <iostream>
+
+std::string_view endpointOf(std::string_view url) {
+    size_t start = url.find("://");
+    start = url.find('/', start == std::string_view::npos ? 0 : start + 3);
+    if (start == std::string_view::npos) return "/";
+    return url.substr(start, url.find('?', start) - start);
+}
+
+namespace {
+
+struct StageHistograms {
+    LatencyHistogram* connect;
+    LatencyHistogram* tls;
+    LatencyHistogram* send;
+    LatencyHistogram* firstByte;
+    LatencyHistogram* total;
+};
+
+// Per-thread cache, so steady-state requests skip the registry lock and the
+// name concatenations.
+const StageHistograms& stagesFor(std::string_view endpoint) {
+    thread_local std::map<std::string, StageHistograms, std::less<>> cache;
+    auto it = cache.find(endpoint);
+    if (it == cache.end()) {
+        std::string name(endpoint);
+        StageHistograms stages{&latency(name + " connect"), &latency(name + " tls"), &latency(name + " send"),
+                               &latency(name + " first_byte"), &latency(name + " total")};
+        it = cache.emplace(name, stages).first;
+    }
+    return it->second;
+}
+
+} // namespace
+
+// Splits curl's cumulative transfer timings into per-stage histograms.
+// Connection setup stages are only recorded when a new connection was made.
+void recordStages(CURL* handle, const std::string& url) {
+    curl_off_t dns = 0, connect = 0, tls = 0, pretransfer = 0, firstByte = 0, total = 0;
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &firstByte);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+
+    const StageHistograms& stages = stagesFor(endpointOf(url));
+    auto stage = [](LatencyHistogram* histogram, curl_off_t fromUs, curl_off_t toUs) {
+        if (toUs > 0 && toUs >= fromUs) histogram->record((toUs - fromUs) * 1000);
+    };
+    stage(stages.connect, dns, connect);
+    stage(stages.tls, connect, tls);
+    stage(stages.send, std::max(connect, tls), pretransfer);
+    stage(stages.firstByte, pretransfer, firstByte);
+    stage(stages.total, 0, total);
+}
+
+HttpPool& HttpPool::instance() {
+    static HttpPool pool;
+    return pool;
+}
+
+HttpPool::HttpPool() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    share_ = curl_share_init();
+    if (!share_) {
+        std::cerr << "[ERROR] curl_share_init failed, requests will not share caches" << std::endl;
+        return;
+    }
+
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &HttpPool::lockShared);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &HttpPool::unlockShared);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+HttpPool::~HttpPool() {
+    clear();
+    if (share_) {
+        curl_share_cleanup(share_);
+    }
+    curl_global_cleanup();
+}
+
+void HttpPool::lockShared(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<HttpPool*>(userptr)->shareLocks_[data].lock();
+}
+
+void HttpPool::unlockShared(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<HttpPool*>(userptr)->shareLocks_[data].unlock();
+}
+
+CURL* HttpPool::acquire() {
+    CURL* handle = nullptr;
+    bool verifyPeer;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex_);
+        if (!idle_.empty()) {
+            handle = idle_.back();
+            idle_.pop_back();
+        }
+        verifyPeer = verifyPeer_;
+    }
+
+    if (handle) {
+        // Resets options only; live connections and caches are kept.
+        curl_easy_reset(handle);
+    } else {
+        handle = curl_easy_init();
+        if (!handle) return nullptr;
+    }
+
+    if (share_) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+    }
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    if (!verifyPeer) {
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+    return handle;
+}
+
+void HttpPool::release(CURL* handle) {
+    if (!handle) return;
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    idle_.push_back(handle);
+}
+
+void HttpPool::setVerifyPeer(bool verify) {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    verifyPeer_ = verify;
+}
+
+void HttpPool::setPolicy(const std::string& endpoint, const RequestPolicy& policy) {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    policies_[endpoint] = policy;
+}
+
+void HttpPool::setDefaultPolicy(const RequestPolicy& policy) {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    defaultPolicy_ = policy;
+}
+
+RequestPolicy HttpPool::policyFor(std::string_view endpoint) {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    auto it = policies_.find(endpoint);
+    return it == policies_.end() ? defaultPolicy_ : it->second;
+}
+
+void HttpPool::clear() {
+    std::vector<CURL*> handles;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex_);
+        handles.swap(idle_);
+    }
+    for (CURL* handle : handles) {
+        curl_easy_cleanup(handle);
+    }
+}
+
+void prepareGet(CURL* handle, const std::string& url, struct curl_slist* headers, std::string& response) {
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    if (headers) {
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+    }
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response);
+
+    RequestPolicy policy = HttpPool::instance().policyFor(endpointOf(url));
+    if (policy.connectTimeoutMs > 0) {
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, policy.connectTimeoutMs);
+    }
+    if (policy.timeoutMs > 0) {
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, policy.timeoutMs);
+    }
+    if (!policy.reuseConnection) {
+        curl_easy_setopt(handle, CURLOPT_FRESH_CONNECT, 1L);
+        curl_easy_setopt(handle, CURLOPT_FORBID_REUSE, 1L);
+    }
+    if (policy.maxIdleSeconds > 0) {
+        curl_easy_setopt(handle, CURLOPT_MAXAGE_CONN, policy.maxIdleSeconds);
+    }
+    if (policy.http2) {
+        // PIPEWAIT: rather wait for a connection that may multiplex than open a new one
+        curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    } else {
+        curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    }
+}
+
+CURLcode pooledGet(const std::string& url, struct curl_slist* headers, std::string& response) {
+    PooledCurl curl;
+    if (!curl) return CURLE_FAILED_INIT;
+
+    prepareGet(curl.get(), url, headers, response);
+    CURLcode res = curl_easy_perform(curl.get());
+    if (res == CURLE_OK) {
+        recordStages(curl.get(), url);
+    }
+    return res;
+}
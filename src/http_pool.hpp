@@ -0,0 +1,93 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <curl/curl.h>
+
+// Per-endpoint transport settings. Zero timeouts mean curl's defaults.
+struct RequestPolicy {
+    long connectTimeoutMs = 0;
+    long timeoutMs = 0;
+    bool reuseConnection = true;  // false: fresh connection, closed afterwards
+    long maxIdleSeconds = 0;      // drop pooled connections idle longer than this
+    bool http2 = true;            // offer h2 via ALPN, falling back to HTTP/1.1 keep-alive
+};
+
+// Process-wide pool of keep-alive curl easy handles.
+//
+// Every handle is attached to one CURLSH so the DNS cache and TLS session
+// cache are shared: a new connection from any thread resumes the TLS session
+// instead of doing a full handshake. Connections are not shared, as libcurl
+// does not support that between concurrent threads. Each handle keeps its own
+// open connection while it sits idle in the pool, so a thread that gets it
+// back skips the TCP + TLS setup entirely.
+class HttpPool {
+public:
+    static HttpPool& instance();
+
+    // Hands out an idle handle (or a new one) with its options reset and the
+    // shared cache attached. Must be given back with release().
+    CURL* acquire();
+    void release(CURL* handle);
+
+    // Disable certificate checks, e.g. for a local self-signed stand-in server.
+    void setVerifyPeer(bool verify);
+
+    // Policy for requests whose path is `endpoint` (e.g. "/api/v2/private/buy");
+    // anything not listed uses the default policy.
+    void setPolicy(const std::string& endpoint, const RequestPolicy& policy);
+    void setDefaultPolicy(const RequestPolicy& policy);
+    RequestPolicy policyFor(std::string_view endpoint);
+
+    // Closes every idle handle.
+    void clear();
+
+private:
+    HttpPool();
+    ~HttpPool();
+    HttpPool(const HttpPool&) = delete;
+    HttpPool& operator=(const HttpPool&) = delete;
+
+    static void lockShared(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+    static void unlockShared(CURL* handle, curl_lock_data data, void* userptr);
+
+    CURLSH* share_;
+    std::mutex shareLocks_[CURL_LOCK_DATA_LAST];
+
+    std::mutex poolMutex_;
+    std::vector<CURL*> idle_;
+    bool verifyPeer_ = true;
+    RequestPolicy defaultPolicy_;
+    std::map<std::string, RequestPolicy, std::less<>> policies_;
+};
+
+// "https://host/api/v2/private/buy?x=1" -> "/api/v2/private/buy"
+std::string_view endpointOf(std::string_view url);
+
+// Sets up `handle` for a GET of `url` into `response`, with the endpoint's
+// RequestPolicy. `headers` and `response` must outlive the transfer.
+void prepareGet(CURL* handle, const std::string& url, struct curl_slist* headers, std::string& response);
+// Records "<path> connect|tls|send|first_byte|total" for a finished transfer.
+void recordStages(CURL* handle, const std::string& url);
+
+// GET `url` on a pooled handle, appending the body to `response`. The
+// endpoint's RequestPolicy is applied.
+CURLcode pooledGet(const std::string& url, struct curl_slist* headers, std::string& response);
+
+// RAII lease on a pooled handle.
+class PooledCurl {
+public:
+    PooledCurl() : handle_(HttpPool::instance().acquire()) {}
+    ~PooledCurl() { if (handle_) HttpPool::instance().release(handle_); }
+    PooledCurl(const PooledCurl&) = delete;
+    PooledCurl& operator=(const PooledCurl&) = delete;
+
+    CURL* get() const { return handle_; }
+    explicit operator bool() const { return handle_ != nullptr; }
+
+private:
+    CURL* handle_;
+};
@@ -0,0 +1,207 @@
+#include "latency_histogram.hpp"
+#include "../json.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+size_t LatencyHistogram::indexOf(int64_t ns) {
+    if (ns < kLinear) return ns < 0 ? 0 : static_cast<size_t>(ns);
+    int msb = 63 - __builtin_clzll(static_cast<uint64_t>(ns));
+    int shift = msb - (kSubBucketBits - 1);
+    int64_t sub = ns >> shift;  // in [kHalf, kLinear)
+    size_t index = kLinear + (shift - 1) * kHalf + (sub - kHalf);
+    return std::min(index, kBuckets - 1);
+}
+
+int64_t LatencyHistogram::valueAt(size_t index) {
+    if (index < static_cast<size_t>(kLinear)) return static_cast<int64_t>(index);
+    size_t k = index - kLinear;
+    int shift = static_cast<int>(k / kHalf) + 1;
+    int64_t low = (static_cast<int64_t>(k % kHalf) + kHalf) << shift;
+    return low + ((int64_t(1) << shift) >> 1);
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    add(ns, 1);
+}
+
+void LatencyHistogram::add(int64_t ns, uint64_t count) {
+    if (ns < 0) ns = 0;
+    counts_[indexOf(ns)].fetch_add(count, std::memory_order_relaxed);
+    count_.fetch_add(count, std::memory_order_relaxed);
+    sum_.fetch_add(ns * static_cast<int64_t>(count), std::memory_order_relaxed);
+
+    int64_t seen = max_.load(std::memory_order_relaxed);
+    while (ns > seen && !max_.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+    }
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n == 0 ? 0.0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / n;
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * n)));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= target) return std::min(valueAt(i), max());
+    }
+    return max();
+}
+
+std::vector<std::pair<int64_t, uint64_t>> LatencyHistogram::buckets() const {
+    std::vector<std::pair<int64_t, uint64_t>> out;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        uint64_t c = counts_[i].load(std::memory_order_relaxed);
+        if (c) out.emplace_back(valueAt(i), c);
+    }
+    return out;
+}
+
+LatencyRegistry& LatencyRegistry::instance() {
+    static LatencyRegistry registry;
+    return registry;
+}
+
+LatencyRegistry::~LatencyRegistry() {
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex_);
+        stopping_ = true;
+    }
+    dumpWake_.notify_all();
+    if (dumper_.joinable()) {
+        dumper_.join();
+        dump(dumpPath_);
+    }
+}
+
+LatencyHistogram& LatencyRegistry::histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = histograms_[name];
+    if (!slot) slot = std::make_unique<LatencyHistogram>();
+    return *slot;
+}
+
+void LatencyRegistry::forEach(const std::function<void(const std::string&, const LatencyHistogram&)>& visit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : histograms_) visit(entry.first, *entry.second);
+}
+
+void LatencyRegistry::dump(const std::string& path) {
+    json snapshot;
+    snapshot["time"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    snapshot["histograms"] = json::object();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : histograms_) {
+            const LatencyHistogram& h = *entry.second;
+            if (h.count() == 0) continue;
+            json buckets = json::array();
+            for (const auto& bucket : h.buckets()) buckets.push_back({bucket.first, bucket.second});
+            snapshot["histograms"][entry.first] = {{"count", h.count()}, {"max", h.max()}, {"buckets", buckets}};
+        }
+    }
+
+    std::ofstream file(path, std::ios_base::app);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR] Could not write latency dump " << path << std::endl;
+        return;
+    }
+    file << snapshot.dump() << '\n';
+}
+
+void LatencyRegistry::startPeriodicDump(const std::string& path, std::chrono::seconds interval) {
+    if (dumper_.joinable()) return;
+    dumpPath_ = path;
+    dumper_ = std::thread([this, path, interval]() {
+        std::unique_lock<std::mutex> lock(dumpMutex_);
+        while (!dumpWake_.wait_for(lock, interval, [this]() { return stopping_; })) {
+            lock.unlock();
+            dump(path);
+            lock.lock();
+        }
+    });
+}
+
+namespace {
+
+// Last (cumulative) snapshot of a dump file, rebuilt into histograms.
+bool loadLastSnapshot(const std::string& path, std::map<std::string, std::unique_ptr<LatencyHistogram>>& out) {
+    std::ifstream file(path);
+    std::string line, last;
+    while (std::getline(file, line)) {
+        if (!line.empty()) last = line;
+    }
+    if (last.empty()) return false;
+
+    try {
+        json snapshot = json::parse(last);
+        for (const auto& entry : snapshot.at("histograms").items()) {
+            auto histogram = std::make_unique<LatencyHistogram>();
+            for (const auto& bucket : entry.value().at("buckets")) {
+                histogram->add(bucket.at(0).get<int64_t>(), bucket.at(1).get<uint64_t>());
+            }
+            // Bucket values are midpoints; keep the exact max
+            histogram->add(entry.value().at("max").get<int64_t>(), 0);
+            out[entry.key()] = std::move(histogram);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Could not parse latency dump " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int printLatencyReport(const std::vector<std::string>& paths) {
+    if (paths.empty()) {
+        std::cerr << "usage: --latency-report <dump> [<dump>...]" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::map<std::string, std::unique_ptr<LatencyHistogram>>> runs(paths.size());
+    std::map<std::string, bool> names;
+    for (size_t r = 0; r < paths.size(); ++r) {
+        if (!loadLastSnapshot(paths[r], runs[r])) {
+            std::cerr << "[ERROR] No snapshot in " << paths[r] << std::endl;
+            return 1;
+        }
+        for (const auto& entry : runs[r]) names[entry.first] = true;
+    }
+
+    size_t nameWidth = 9;
+    for (const auto& name : names) nameWidth = std::max(nameWidth, name.first.size());
+    size_t runWidth = 3;
+    for (const auto& path : paths) runWidth = std::max(runWidth, path.size());
+
+    auto us = [](int64_t ns) { return ns / 1000.0; };
+    std::printf("%-*s  %-*s %10s %10s %10s %10s %10s %10s   (us)\n", int(nameWidth), "histogram",
+                int(runWidth), "run", "count", "p50", "p90", "p99", "p99.9", "max");
+    for (const auto& name : names) {
+        for (size_t r = 0; r < paths.size(); ++r) {
+            auto it = runs[r].find(name.first);
+            const char* label = r == 0 ? name.first.c_str() : "";
+            if (it == runs[r].end()) {
+                std::printf("%-*s  %-*s %10s\n", int(nameWidth), label, int(runWidth), paths[r].c_str(), "-");
+                continue;
+            }
+            const LatencyHistogram& h = *it->second;
+            std::printf("%-*s  %-*s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", int(nameWidth), label,
+                        int(runWidth), paths[r].c_str(), static_cast<unsigned long long>(h.count()),
+                        us(h.percentile(50)), us(h.percentile(90)), us(h.percentile(99)),
+                        us(h.percentile(99.9)), us(h.max()));
+        }
+    }
+    return 0;
+}
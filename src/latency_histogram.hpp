@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// HDR-style latency histogram over nanoseconds.
+//
+// Values below 256 ns get a bucket each; above that every power of two is
+// split into 128 linear sub-buckets, so a reported percentile is within 0.4%
+// of the recorded value. Recording is a handful of relaxed atomic adds and is
+// safe from any thread.
+class LatencyHistogram {
+public:
+    void record(int64_t ns);
+    // Adds `count` samples of `ns`, e.g. when merging dumps.
+    void add(int64_t ns, uint64_t count);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    int64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+    // Value at percentile `p` (0-100), in ns; 0 when empty.
+    int64_t percentile(double p) const;
+
+    // Non-empty buckets as (value ns, count), lowest first.
+    std::vector<std::pair<int64_t, uint64_t>> buckets() const;
+
+private:
+    static constexpr int kSubBucketBits = 8;
+    static constexpr int64_t kLinear = int64_t(1) << kSubBucketBits;  // exact below this
+    static constexpr int64_t kHalf = kLinear / 2;
+    static constexpr int kMaxBits = 42;                               // ~73 minutes
+    static constexpr size_t kBuckets = kLinear + (kMaxBits - kSubBucketBits + 1) * kHalf;
+
+    static size_t indexOf(int64_t ns);
+    static int64_t valueAt(size_t index);
+
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<int64_t> sum_{0};
+    std::atomic<int64_t> max_{0};
+};
+
+// Named histograms, e.g. "/api/v2/private/buy first_byte" or "feed handoff".
+// Snapshots are appended to a file as one JSON line each; they are cumulative,
+// so the last line of a run describes the whole run.
+class LatencyRegistry {
+public:
+    static LatencyRegistry& instance();
+    ~LatencyRegistry();
+
+    // Created on first use; the reference stays valid for the process lifetime.
+    LatencyHistogram& histogram(const std::string& name);
+
+    void forEach(const std::function<void(const std::string&, const LatencyHistogram&)>& visit);
+
+    void dump(const std::string& path);
+    // Dumps every `interval` on a background thread, and once more on exit.
+    void startPeriodicDump(const std::string& path, std::chrono::seconds interval);
+
+private:
+    LatencyRegistry() = default;
+    LatencyRegistry(const LatencyRegistry&) = delete;
+    LatencyRegistry& operator=(const LatencyRegistry&) = delete;
+
+    std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms_;
+
+    std::mutex dumpMutex_;
+    std::condition_variable dumpWake_;
+    bool stopping_ = false;
+    std::string dumpPath_;
+    std::thread dumper_;
+};
+
+inline LatencyHistogram& latency(const std::string& name) {
+    return LatencyRegistry::instance().histogram(name);
+}
+
+// Records the time from construction to destruction.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        histogram_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// `main --latency-report <dump> [<dump>...]`: reads the last snapshot of each
+// dump and prints p50/p90/p99/p99.9/max per histogram, one row per run.
+int printLatencyReport(const std::vector<std::string>& paths);
@@ -1,12 +1,73 @@
 #include <iostream>
+#include <vector>
 #include <curl/curl.h>
 #include "../json.hpp"
 #include "websocket_server.hpp"
 #include "utils.hpp"
+#include "benchmarks.hpp"
+#include "async_logger.hpp"
+#include "latency_histogram.hpp"
+#include "mock_exchange.hpp"
+#include "deribit_config.hpp"
+#include "token_manager.hpp"
 
 using json = nlohmann::json;
 
-int main() {
+int main(int argc, char* argv[]) {
+    AsyncLogger::instance().setLevel(parseLogLevel(getEnvValueOr("LOG_LEVEL", "info")));
+    // Local server io threads (SERVER_THREADS, default 1), optionally pinned to cores
+    unsigned serverThreads = static_cast<unsigned>(getEnvNumberOr("SERVER_THREADS", 1, 1));
+    bool pinServerThreads = getEnvValueOr("SERVER_PIN", "0") == "1";
+
+    if (argc > 2 && std::string(argv[1]) == "--bench") {
+        return runBenchmark(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+    if (argc > 1 && std::string(argv[1]) == "--latency-report") {
+        return printLatencyReport(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    // --replay <capture> [speed|max]: serve a recorded session on port 9002
+    if (argc > 2 && std::string(argv[1]) == "--replay") {
+        double speed = 1.0;
+        if (argc > 3 && std::string(argv[3]) == "max") {
+            speed = 0.0;
+        } else if (argc > 3 && (!parseNumber(argv[3], speed) || speed <= 0)) {
+            std::cerr << "usage: " << argv[0] << " --replay <capture> [speed|max]  (speed > 0, e.g. 2 or 0.5)" << std::endl;
+            return 1;
+        }
+        WebSocketServer server;
+        server.setBackpressurePolicy(BackpressurePolicy::fromEnv());
+        server.runReplay(9002, argv[2], speed, serverThreads, pinServerThreads);
+        return 0;
+    }
+
+    // --mock-exchange [port] [updates/s] [latency-ms]: local stand-in for test.deribit.com
+    if (argc > 1 && std::string(argv[1]) == "--mock-exchange") {
+        MockExchange::Config config;
+        long port = 8443, latencyMs = 0;
+        bool valid = (argc <= 2 || (parseNumber(argv[2], port) && port >= 1 && port <= 65535)) &&
+                     (argc <= 3 || (parseNumber(argv[3], config.updatesPerSecond) && config.updatesPerSecond > 0)) &&
+                     (argc <= 4 || (parseNumber(argv[4], latencyMs) && latencyMs >= 0 && latencyMs <= 60000));
+        if (!valid) {
+            std::cerr << "usage: " << argv[0] << " --mock-exchange [port 1-65535] [updates/s > 0] [latency-ms 0-60000]"
+                      << std::endl;
+            return 1;
+        }
+        config.latencyMs = static_cast<int>(latencyMs);
+        std::vector<std::string> instruments = splitList(getEnvValueOr("DERIBIT_INSTRUMENTS", ""));
+        if (!instruments.empty()) config.instruments = instruments;
+        MockExchange exchange(config);
+        exchange.run(static_cast<uint16_t>(port));
+        return 0;
+    }
+    // REST/WS targets and per-endpoint transport policies (DERIBIT_ENV etc.)
+    DeribitConfig::instance().apply();
+    DeribitConfig::instance().print();
+
+    // Cumulative latency histograms, one JSON snapshot per line
+    LatencyRegistry::instance().startPeriodicDump(
+        getEnvValueOr("LATENCY_DUMP", "latency.jsonl"),
+        std::chrono::seconds(getEnvNumberOr("LATENCY_DUMP_INTERVAL", 60, 1)));
+
     std::string client_id = getEnvValue("DERIBIT_CLIENT_ID");
     std::string client_secret = getEnvValue("DERIBIT_CLIENT_SECRET");
 
@@ -15,14 +76,25 @@ int main() {
         return 1;
     }
 
-    std::string accessToken = getAccessToken(client_id, client_secret);
-    if (accessToken.empty()) {
+    // Renewed in the background; read tokens.current() per request
+    TokenManager tokens;
+    if (!tokens.start(client_id, client_secret)) {
         std::cerr << "Failed to obtain access token!" << std::endl;
         return 1;
     }
-    std::cout << "Access Token: " << accessToken << std::endl;
+    std::cout << "Access Token: " << *tokens.current() << std::endl;
+
+    std::string currency = "BTC";
+    std::string kind = "future";
+    std::string instrument = "BTC-PERPETUAL";
+    int depth = 10;
+
+    // Independent requests go out together; only the sell -> edit -> cancel
+    // chain below has to wait on its own responses.
+    std::future<OrderAck> buyFuture = placeBuyOrderAsync(*tokens.current(), "ETH-PERPETUAL", 10, 0, "market");
+    std::future<std::string> bookFuture = getOrderBookAsync(instrument, depth);
 
-    std::string accountResponse = makeAuthenticatedRequest("/api/v2/private/get_account_summary?currency=BTC", accessToken);
+    std::string accountResponse = makeAuthenticatedRequest("/api/v2/private/get_account_summary?currency=BTC", *tokens.current());
 
     try {
         json jsonResponse = json::parse(accountResponse);
@@ -35,43 +107,60 @@ int main() {
         std::cerr << "JSON Parsing Error: " << e.what() << std::endl;
     }
 
-    std::string orderResponse = placeBuyOrder(accessToken, "ETH-PERPETUAL", 10, 0, "market");
+    OrderAck buyAck = buyFuture.get();
 
-    std::cout << "Order Buy Response: " << orderResponse << std::endl;
+    std::cout << "Order Buy Response: " << buyAck << std::endl;
 
-std::string sellOrderId = placeSellOrder(accessToken, "ETH-PERPETUAL", 10, 85000, "limit");
+    // Only after the buy is acknowledged, so the positions reflect it
+    std::future<std::vector<Position>> positionsFuture = getPositionsAsync(*tokens.current(), currency, kind);
 
-    if (!sellOrderId.empty()) {
+    OrderAck sellAck = placeSellOrder(*tokens.current(), "ETH-PERPETUAL", 10, 85000, "limit");
+
+    if (sellAck.ok) {
+        std::string sellOrderId = sellAck.order.orderId.str();
         std::cout << "Sell Order ID: " << sellOrderId << std::endl;
 
-        std::string modifyResponse = modifyOrder(accessToken, sellOrderId, 10000, 84500);
-        std::cout << "Modify Order Response: " << modifyResponse << std::endl;
+        OrderAck modifyAck = modifyOrder(*tokens.current(), sellOrderId, 10000, 84500);
+        std::cout << "Modify Order Response: " << modifyAck << std::endl;
 
-        std::string cancelResponse = cancelOrder(accessToken, sellOrderId);
-        std::cout << "Cancel Order Response: " << cancelResponse << std::endl;
+        OrderAck cancelAck = cancelOrder(*tokens.current(), sellOrderId);
+        std::cout << "Cancel Order Response: " << cancelAck << std::endl;
     } else {
-        std::cerr << "Sell order failed, skipping modify/cancel." << std::endl;
+        std::cerr << "Sell order failed (" << sellAck << "), skipping modify/cancel." << std::endl;
     }
 
-    std::string currency = "BTC";
-    std::string kind = "future";
-    std::string instrument = "BTC-PERPETUAL";
-    int depth = 10;
-
     std::cout << "Fetching market data..." << std::endl;
-    json marketData = getMarketData(currency, kind, instrument, depth);
+    json marketData;
+    try {
+        marketData["orderbook"] = json::parse(bookFuture.get());
+    } catch (const std::exception& e) {
+        std::cerr << "JSON Parsing Error: " << e.what() << std::endl;
+    }
 
     std::cout << "Market Data: " << marketData.dump(4) << std::endl;
 
 
     std::cout << "Fetching open positions..." << std::endl;
-    json positions = getPositions(accessToken, "BTC", "future");
+    std::vector<Position> positions = positionsFuture.get();
 
-    std::cout << "Open Positions: " << positions.dump(4) << std::endl;
+    std::cout << "Open Positions: " << positions.size() << std::endl;
+    for (const auto& position : positions) {
+        std::cout << "  " << position << std::endl;
+    }
 
     WebSocketServer server;
+    server.setTokenManager(&tokens);
+    server.setCredentials(client_id, client_secret);
+    server.setBackpressurePolicy(BackpressurePolicy::fromEnv());
+    server.setInstruments(loadInstrumentUniverse());
+    // BOOK_INTERVAL=raw: every book change instead of 100 ms aggregates (needs auth)
+    server.setFeedChannels(getEnvValueOr("BOOK_INTERVAL", "100ms"), getEnvValueOr("FEED_TRADES", "0") == "1");
+    std::string capturePath = getEnvValueOr("FEED_CAPTURE", "");
+    if (!capturePath.empty()) {
+        server.startCapture(capturePath);
+    }
     std::cout << "Starting WebSocket Server on port 9002..." << std::endl;
-    server.run(9002);
+    server.run(9002, serverThreads, pinServerThreads);
     return 0;
 }
 
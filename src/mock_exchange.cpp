@@ -0,0 +1,537 @@
+#include "mock_exchange.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+namespace {
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Throwaway EC key and self-signed certificate for CN=localhost, as PEM.
+bool generateCertificate(std::string& certificatePem, std::string& keyPem) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    bool ok = key && cert;
+    if (ok) {
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 365L * 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        ok = X509_sign(cert, key, EVP_sha256()) > 0;
+    }
+
+    auto toPem = [](const std::function<int(BIO*)>& write, std::string& out) {
+        BIO* bio = BIO_new(BIO_s_mem());
+        bool written = bio && write(bio) == 1;
+        if (written) {
+            char* data = nullptr;
+            long size = BIO_get_mem_data(bio, &data);
+            out.assign(data, size);
+        }
+        BIO_free(bio);
+        return written;
+    };
+    ok = ok && toPem([&](BIO* bio) { return PEM_write_bio_X509(bio, cert); }, certificatePem) &&
+         toPem([&](BIO* bio) { return PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr); },
+               keyPem);
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+// "a=1&b=x" -> {"a": "1", "b": "x"}; values stay strings.
+json parseQuery(const std::string& query) {
+    json params = json::object();
+    size_t start = 0;
+    while (start < query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) end = query.size();
+        std::string pair = query.substr(start, end - start);
+        size_t eq = pair.find('=');
+        if (eq != std::string::npos) params[pair.substr(0, eq)] = pair.substr(eq + 1);
+        start = end + 1;
+    }
+    return params;
+}
+
+// Numeric parameter given as a JSON number (WebSocket) or string (REST query).
+bool numberParam(const json& params, const char* key, double& out) {
+    if (!params.contains(key)) return false;
+    const json& value = params[key];
+    if (value.is_number()) {
+        out = value.get<double>();
+        return true;
+    }
+    if (!value.is_string()) return false;
+    const std::string& text = value.get_ref<const std::string&>();
+    char* end = nullptr;
+    out = std::strtod(text.c_str(), &end);
+    return end != text.c_str();
+}
+
+std::string stringParam(const json& params, const char* key) {
+    return params.contains(key) && params[key].is_string() ? params[key].get<std::string>() : "";
+}
+
+json rpcError(int code, const std::string& message) {
+    return {{"code", code}, {"message", message}};
+}
+
+// ("book.BTC-PERPETUAL.100ms", "book.") -> "BTC-PERPETUAL"
+std::string channelInstrument(const std::string& channel, const std::string& prefix) {
+    if (channel.compare(0, prefix.size(), prefix) != 0) return "";
+    size_t end = channel.find('.', prefix.size());
+    return channel.substr(prefix.size(), end == std::string::npos ? std::string::npos : end - prefix.size());
+}
+
+std::string bookInstrument(const std::string& channel) {
+    return channelInstrument(channel, "book.");
+}
+
+// Raw channels are only available on authorized connections
+bool isRawChannel(const std::string& channel) {
+    return channel.size() > 4 && channel.compare(channel.size() - 4, 4, ".raw") == 0;
+}
+
+} // namespace
+
+MockExchange::MockExchange(Config config) : config_(std::move(config)) {
+    if (!generateCertificate(certificatePem_, keyPem_)) {
+        std::cerr << "[ERROR] Could not generate the mock exchange certificate" << std::endl;
+    }
+
+    server_.clear_access_channels(websocketpp::log::alevel::all);
+    server_.clear_error_channels(websocketpp::log::elevel::all);
+    server_.init_asio();
+    server_.set_reuse_addr(true);
+
+    server_.set_tls_init_handler([this](websocketpp::connection_hdl) {
+        auto ctx = std::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tlsv12);
+        ctx->set_options(boost::asio::ssl::context::default_workarounds |
+                         boost::asio::ssl::context::no_sslv2 |
+                         boost::asio::ssl::context::no_sslv3);
+        ctx->use_certificate_chain(boost::asio::buffer(certificatePem_));
+        ctx->use_private_key(boost::asio::buffer(keyPem_), boost::asio::ssl::context::pem);
+        return ctx;
+    });
+    server_.set_http_handler(std::bind(&MockExchange::onHttp, this, std::placeholders::_1));
+    server_.set_message_handler(std::bind(&MockExchange::onMessage, this,
+                                          std::placeholders::_1, std::placeholders::_2));
+    server_.set_open_handler([this](websocketpp::connection_hdl hdl) { sessions_[hdl]; });
+    server_.set_close_handler(std::bind(&MockExchange::onClose, this, std::placeholders::_1));
+
+    tickTimer_ = std::make_unique<boost::asio::steady_timer>(server_.get_io_service());
+}
+
+void MockExchange::run(uint16_t port) {
+    try {
+        server_.listen(port);
+        server_.start_accept();
+        std::cout << "[MOCK] Mock Deribit exchange on https/wss port " << port << ", "
+                  << config_.updatesPerSecond << " book updates/s, " << config_.latencyMs
+                  << " ms injected latency" << std::endl;
+        scheduleTick();
+        server_.run();
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Mock exchange failed: " << e.what() << std::endl;
+    }
+}
+
+void MockExchange::stop() {
+    websocketpp::lib::error_code ec;
+    server_.stop_listening(ec);
+    server_.stop();
+}
+
+void MockExchange::dropConnections() {
+    server_.get_io_service().post([this]() {
+        for (const auto& session : sessions_) {
+            websocketpp::lib::error_code ec;
+            server_.close(session.first, websocketpp::close::status::going_away, "mock restart", ec);
+        }
+    });
+}
+
+void MockExchange::onHttp(websocketpp::connection_hdl hdl) {
+    ServerType::connection_ptr con = server_.get_con_from_hdl(hdl);
+    const std::string& resource = con->get_resource();
+    size_t queryPos = resource.find('?');
+    std::string path = resource.substr(0, queryPos);
+    json params = parseQuery(queryPos == std::string::npos ? "" : resource.substr(queryPos + 1));
+
+    static const std::string prefix = "/api/v2/";
+    json response = {{"jsonrpc", "2.0"}};
+    auto status = websocketpp::http::status_code::ok;
+    if (path.compare(0, prefix.size(), prefix) != 0) {
+        status = websocketpp::http::status_code::not_found;
+        response["error"] = rpcError(-32601, "Method not found");
+    } else {
+        json error;
+        bool authorized = con->get_request_header("Authorization").compare(0, 7, "Bearer ") == 0;
+        json result = call(path.substr(prefix.size()), params, authorized, error);
+        if (error.is_null()) {
+            response["result"] = std::move(result);
+        } else {
+            status = websocketpp::http::status_code::bad_request;
+            response["error"] = std::move(error);
+        }
+    }
+    response["testnet"] = true;
+
+    std::string body = response.dump();
+    auto fill = [con, status, body]() {
+        con->set_status(status);
+        con->append_header("Content-Type", "application/json");
+        con->set_body(body);
+    };
+    if (config_.latencyMs <= 0) {
+        fill();
+        return;
+    }
+    con->defer_http_response();
+    delayed([con, fill]() {
+        fill();
+        websocketpp::lib::error_code ec;
+        con->send_http_response(ec);
+    });
+}
+
+void MockExchange::onMessage(websocketpp::connection_hdl hdl, ServerType::message_ptr msg) {
+    json request = json::parse(msg->get_payload(), nullptr, false);
+    if (request.is_discarded() || !request.is_object()) {
+        send(hdl, json({{"jsonrpc", "2.0"}, {"error", rpcError(-32700, "Parse error")}}).dump());
+        return;
+    }
+
+    json id = request.value("id", json());
+    std::string method = request.value("method", "");
+    json params = request.contains("params") && request["params"].is_object() ? request["params"] : json::object();
+    Session& session = sessions_[hdl];
+    json response = {{"jsonrpc", "2.0"}, {"id", id}};
+    std::vector<std::string> snapshots;
+
+    bool authorized = session.authorized || params.contains("access_token");
+    bool privateSubscription = method == "private/subscribe" || method == "private/unsubscribe";
+
+    if (privateSubscription && !authorized) {
+        response["error"] = rpcError(13009, "unauthorized");
+    } else if (privateSubscription || method == "public/subscribe" || method == "public/unsubscribe") {
+        bool subscribe = method == "public/subscribe" || method == "private/subscribe";
+        json changed = json::array();
+        if (params.contains("channels") && params["channels"].is_array()) {
+            for (const auto& channel : params["channels"]) {
+                if (!channel.is_string()) continue;
+                std::string name = channel.get<std::string>();
+                if (subscribe && isRawChannel(name) && !authorized) continue;
+                bool isNew = subscribe ? session.channels.insert(name).second : session.channels.erase(name) > 0;
+                if (subscribe && isNew && !bookInstrument(name).empty()) snapshots.push_back(name);
+                changed.push_back(name);
+            }
+        }
+        response["result"] = changed;
+    } else {
+        if (method == "public/auth") session.authorized = authorized = true;
+        json error;
+        json result = call(method, params, authorized, error);
+        if (error.is_null()) response["result"] = std::move(result);
+        else response["error"] = std::move(error);
+    }
+
+    // Snapshots are taken now, so they line up with the changes that follow
+    std::vector<std::string> messages = {response.dump()};
+    for (const auto& channel : snapshots) {
+        std::string instrument = bookInstrument(channel);
+        messages.push_back(bookNotification(channel, instrument, snapshotData(instrument, book(instrument))).dump());
+    }
+    delayed([this, hdl, messages]() {
+        for (const auto& message : messages) send(hdl, message);
+    });
+}
+
+void MockExchange::onClose(websocketpp::connection_hdl hdl) {
+    sessions_.erase(hdl);
+}
+
+json MockExchange::call(const std::string& method, const json& params, bool authorized, json& error) {
+    if (method.compare(0, 8, "private/") == 0 && !authorized) {
+        error = rpcError(13009, "unauthorized");
+        return json();
+    }
+
+    if (method == "public/auth") {
+        return {{"access_token", "mock-access-token"}, {"refresh_token", "mock-refresh-token"},
+                {"expires_in", 900}, {"scope", "connection mainaccount"}, {"token_type", "bearer"}};
+    }
+    if (method == "public/test") return {{"version", "mock"}};
+    if (method == "public/set_heartbeat" || method == "public/disable_heartbeat") return "ok";
+    if (method == "public/get_instruments") {
+        std::string currency = stringParam(params, "currency");
+        json instruments = json::array();
+        for (const auto& name : config_.instruments) {
+            if (!currency.empty() && name.compare(0, currency.size(), currency) != 0) continue;
+            instruments.push_back({{"instrument_name", name}, {"kind", "future"},
+                                   {"base_currency", name.substr(0, name.find('-'))}, {"is_active", true}});
+        }
+        return instruments;
+    }
+    if (method == "public/get_order_book") {
+        std::string instrument = stringParam(params, "instrument_name");
+        if (instrument.empty()) {
+            error = rpcError(-32602, "Invalid params");
+            return json();
+        }
+        double depth = config_.depth;
+        numberParam(params, "depth", depth);
+        return orderBook(instrument, static_cast<size_t>(depth));
+    }
+    if (method == "private/buy") return placeOrder("buy", params, error);
+    if (method == "private/sell") return placeOrder("sell", params, error);
+    if (method == "private/edit") return editOrder(params, error);
+    if (method == "private/cancel") return cancelOrder(params, error);
+    if (method == "private/get_positions") return positions(params);
+    if (method == "private/get_account_summary") {
+        std::string currency = stringParam(params, "currency");
+        return {{"currency", currency.empty() ? "BTC" : currency}, {"balance", 10.0}, {"equity", 10.0},
+                {"available_funds", 10.0}};
+    }
+
+    error = rpcError(-32601, "Method not found");
+    return json();
+}
+
+json MockExchange::placeOrder(const std::string& direction, const json& params, json& error) {
+    std::string instrument = stringParam(params, "instrument_name");
+    double amount = 0;
+    if (instrument.empty() || !numberParam(params, "amount", amount) || amount <= 0) {
+        error = rpcError(-32602, "Invalid params");
+        return json();
+    }
+    std::string type = stringParam(params, "type");
+    if (type.empty()) type = "limit";
+
+    Book& b = book(instrument);
+    double price = 0;
+    bool filled = type == "market";
+    if (filled) {
+        price = direction == "buy" ? b.asks.begin()->first : b.bids.begin()->first;
+        positions_[instrument] += direction == "buy" ? amount : -amount;
+    } else if (!numberParam(params, "price", price)) {
+        error = rpcError(-32602, "Invalid params");
+        return json();
+    }
+
+    std::string orderId = "MOCK-" + std::to_string(nextOrderId_++);
+    json order = {{"order_id", orderId}, {"instrument_name", instrument}, {"direction", direction},
+                  {"amount", amount}, {"price", price}, {"order_type", type},
+                  {"order_state", filled ? "filled" : "open"}, {"filled_amount", filled ? amount : 0.0},
+                  {"creation_timestamp", nowMs()}, {"last_update_timestamp", nowMs()}};
+    json trades = json::array();
+    if (filled) {
+        trades.push_back({{"trade_id", orderId + "-1"}, {"instrument_name", instrument}, {"direction", direction},
+                          {"amount", amount}, {"price", price}, {"order_id", orderId}, {"timestamp", nowMs()}});
+    } else {
+        orders_[orderId] = order;
+    }
+    return {{"order", order}, {"trades", trades}};
+}
+
+json MockExchange::editOrder(const json& params, json& error) {
+    auto it = orders_.find(stringParam(params, "order_id"));
+    double amount = 0, price = 0;
+    if (it == orders_.end()) {
+        error = rpcError(10004, "order_not_found");
+        return json();
+    }
+    if (!numberParam(params, "amount", amount) || !numberParam(params, "price", price)) {
+        error = rpcError(-32602, "Invalid params");
+        return json();
+    }
+    it->second["amount"] = amount;
+    it->second["price"] = price;
+    it->second["last_update_timestamp"] = nowMs();
+    return {{"order", it->second}, {"trades", json::array()}};
+}
+
+json MockExchange::cancelOrder(const json& params, json& error) {
+    auto it = orders_.find(stringParam(params, "order_id"));
+    if (it == orders_.end()) {
+        error = rpcError(10004, "order_not_found");
+        return json();
+    }
+    json order = it->second;
+    order["order_state"] = "cancelled";
+    order["last_update_timestamp"] = nowMs();
+    orders_.erase(it);
+    return order;
+}
+
+json MockExchange::positions(const json& params) {
+    std::string currency = stringParam(params, "currency");
+    json result = json::array();
+    for (const auto& position : positions_) {
+        if (!currency.empty() && position.first.compare(0, currency.size(), currency) != 0) continue;
+        result.push_back({{"instrument_name", position.first}, {"kind", "future"}, {"size", position.second},
+                          {"direction", position.second > 0 ? "buy" : position.second < 0 ? "sell" : "zero"}});
+    }
+    return result;
+}
+
+json MockExchange::orderBook(const std::string& instrument, size_t depth) {
+    Book& b = book(instrument);
+    json bids = json::array(), asks = json::array();
+    for (const auto& level : b.bids) {
+        if (bids.size() == depth) break;
+        bids.push_back({level.first, level.second});
+    }
+    for (const auto& level : b.asks) {
+        if (asks.size() == depth) break;
+        asks.push_back({level.first, level.second});
+    }
+    return {{"instrument_name", instrument}, {"change_id", b.changeId}, {"timestamp", nowMs()},
+            {"bids", bids}, {"asks", asks}, {"best_bid_price", b.bids.begin()->first},
+            {"best_ask_price", b.asks.begin()->first}, {"state", "open"}};
+}
+
+MockExchange::Book& MockExchange::book(const std::string& instrument) {
+    auto it = books_.find(instrument);
+    if (it != books_.end()) return it->second;
+
+    Book& b = books_[instrument];
+    double mid = 100;
+    b.tick = 0.01;
+    if (instrument.compare(0, 3, "BTC") == 0) {
+        mid = 60000;
+        b.tick = 0.5;
+    } else if (instrument.compare(0, 3, "ETH") == 0) {
+        mid = 3000;
+        b.tick = 0.05;
+    }
+    std::uniform_int_distribution<int> lots(1, 100);
+    for (int level = 0; level < config_.depth; ++level) {
+        b.bids[mid - (level + 1) * b.tick] = lots(rng_) * 10.0;
+        b.asks[mid + (level + 1) * b.tick] = lots(rng_) * 10.0;
+    }
+    b.changeId = 1;
+    return b;
+}
+
+json MockExchange::bookNotification(const std::string& channel, const std::string& instrument, const json& data) {
+    json notification = {{"jsonrpc", "2.0"}, {"method", "subscription"},
+                         {"params", {{"channel", channel}, {"data", data}}}};
+    notification["params"]["data"]["instrument_name"] = instrument;
+    return notification;
+}
+
+json MockExchange::snapshotData(const std::string& instrument, Book& b) {
+    json bids = json::array(), asks = json::array();
+    for (const auto& level : b.bids) bids.push_back({"new", level.first, level.second});
+    for (const auto& level : b.asks) asks.push_back({"new", level.first, level.second});
+    return {{"type", "snapshot"}, {"instrument_name", instrument}, {"change_id", b.changeId},
+            {"timestamp", nowMs()}, {"bids", bids}, {"asks", asks}};
+}
+
+void MockExchange::scheduleTick() {
+    if (config_.updatesPerSecond <= 0) return;
+    tickTimer_->expires_after(std::chrono::nanoseconds(static_cast<int64_t>(1e9 / config_.updatesPerSecond)));
+    tickTimer_->async_wait([this](const boost::system::error_code& ec) {
+        if (ec) return;
+        publishTick();
+        scheduleTick();
+    });
+}
+
+void MockExchange::publishTick() {
+    // Instruments somebody is subscribed to, with their channels
+    std::map<std::string, std::vector<std::pair<websocketpp::connection_hdl, std::string>>> targets, tradeTargets;
+    for (const auto& session : sessions_) {
+        for (const auto& channel : session.second.channels) {
+            std::string instrument = bookInstrument(channel);
+            if (!instrument.empty()) targets[instrument].emplace_back(session.first, channel);
+            instrument = channelInstrument(channel, "trades.");
+            if (!instrument.empty()) tradeTargets[instrument].emplace_back(session.first, channel);
+        }
+    }
+
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<int> lots(1, 100);
+    for (const auto& target : targets) {
+        Book& b = book(target.first);
+        bool bidSide = coin(rng_) < 0.5;
+        size_t size = bidSide ? b.bids.size() : b.asks.size();
+        size_t index = std::uniform_int_distribution<size_t>(0, size - 1)(rng_);
+        json bids = json::array(), asks = json::array();
+        json& changes = bidSide ? bids : asks;
+
+        auto touch = [&](auto& side, int outward) {
+            auto level = std::next(side.begin(), index);
+            if (coin(rng_) < 0.8 || side.size() < 2) {
+                // Resize a resting level
+                level->second = lots(rng_) * 10.0;
+                changes.push_back({"change", level->first, level->second});
+            } else {
+                // One level leaves, a new one joins at the far end
+                double worst = std::prev(side.end())->first;
+                changes.push_back({"delete", level->first, 0.0});
+                side.erase(level);
+                double price = worst + outward * b.tick;
+                side[price] = lots(rng_) * 10.0;
+                changes.push_back({"new", price, side[price]});
+            }
+        };
+        if (bidSide) touch(b.bids, -1);
+        else touch(b.asks, 1);
+
+        int64_t prev = b.changeId++;
+        json data = {{"type", "change"}, {"change_id", b.changeId}, {"prev_change_id", prev},
+                     {"timestamp", nowMs()}, {"bids", bids}, {"asks", asks}};
+        for (const auto& subscriber : target.second) {
+            send(subscriber.first, bookNotification(subscriber.second, target.first, data).dump());
+        }
+    }
+
+    // Now and then somebody lifts the offer or hits the bid
+    for (const auto& target : tradeTargets) {
+        if (coin(rng_) >= 0.3) continue;
+        Book& b = book(target.first);
+        bool buy = coin(rng_) < 0.5;
+        if ((buy ? b.asks : b.bids).empty()) continue;
+        double price = buy ? b.asks.begin()->first : b.bids.begin()->first;
+        int64_t seq = nextTradeSeq_++;
+        json trade = {{"trade_seq", seq}, {"trade_id", "MOCK-T" + std::to_string(seq)}, {"timestamp", nowMs()},
+                      {"price", price}, {"amount", lots(rng_) * 10.0}, {"direction", buy ? "buy" : "sell"},
+                      {"instrument_name", target.first}, {"tick_direction", buy ? 0 : 2}};
+        for (const auto& subscriber : target.second) {
+            json notification = {{"jsonrpc", "2.0"}, {"method", "subscription"},
+                                 {"params", {{"channel", subscriber.second}, {"data", json::array({trade})}}}};
+            send(subscriber.first, notification.dump());
+        }
+    }
+}
+
+void MockExchange::send(websocketpp::connection_hdl hdl, const std::string& payload) {
+    websocketpp::lib::error_code ec;
+    server_.send(hdl, payload, websocketpp::frame::opcode::text, ec);
+}
+
+void MockExchange::delayed(std::function<void()> action) {
+    if (config_.latencyMs <= 0) {
+        action();
+        return;
+    }
+    auto timer = std::make_shared<boost::asio::steady_timer>(server_.get_io_service(),
+                                                             std::chrono::milliseconds(config_.latencyMs));
+    timer->async_wait([timer, action](const boost::system::error_code& ec) {
+        if (!ec) action();
+    });
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <websocketpp/config/asio.hpp>
+#include <websocketpp/server.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "../json.hpp"
+
+using json = nlohmann::json;
+
+// In-process stand-in for test.deribit.com, for load and latency tests with no
+// network.
+//
+// One TLS port, using a self-signed certificate generated at startup, serves:
+// - the REST endpoints the client uses: public/auth, private/buy, sell, edit,
+//   cancel, public/get_order_book, private/get_positions and a few others;
+// - the WebSocket JSON-RPC API, including book.* and trades.* subscriptions
+//   (*.raw channels only on authorized connections or via private/subscribe).
+// Books are random walks published at a configurable rate, and every response
+// can be delayed to mimic WAN latency.
+//
+// Point the client at it with DERIBIT_ENV=mock (port 8443), or for another
+// port DERIBIT_REST_URL / DERIBIT_WS_URL plus DERIBIT_TLS_VERIFY=0.
+class MockExchange {
+public:
+    struct Config {
+        double updatesPerSecond = 10;  // per subscribed book
+        int latencyMs = 0;             // added before every response
+        int depth = 20;                // levels per side
+        std::vector<std::string> instruments = {"BTC-PERPETUAL", "ETH-PERPETUAL"};
+    };
+    typedef websocketpp::server<websocketpp::config::asio_tls> ServerType;
+
+    explicit MockExchange(Config config);
+
+    // Blocks until stop().
+    void run(uint16_t port);
+    void stop();
+    // Closes every WebSocket session (1001 going away), as a restart on the
+    // exchange side would. For reconnect tests; callable from any thread.
+    void dropConnections();
+
+private:
+    struct Book {
+        std::map<double, double, std::greater<double>> bids;
+        std::map<double, double> asks;
+        double tick = 0.5;
+        int64_t changeId = 0;
+    };
+    struct Session {
+        std::set<std::string> channels;
+        bool authorized = false;
+    };
+
+    void onHttp(websocketpp::connection_hdl hdl);
+    void onMessage(websocketpp::connection_hdl hdl, ServerType::message_ptr msg);
+    void onClose(websocketpp::connection_hdl hdl);
+
+    // Shared by REST and JSON-RPC. Returns the result, or fills `error`.
+    json call(const std::string& method, const json& params, bool authorized, json& error);
+    json placeOrder(const std::string& direction, const json& params, json& error);
+    json editOrder(const json& params, json& error);
+    json cancelOrder(const json& params, json& error);
+    json positions(const json& params);
+    json orderBook(const std::string& instrument, size_t depth);
+
+    Book& book(const std::string& instrument);
+    json bookNotification(const std::string& channel, const std::string& instrument, const json& data);
+    json snapshotData(const std::string& instrument, Book& book);
+    void scheduleTick();
+    void publishTick();
+
+    void send(websocketpp::connection_hdl hdl, const std::string& payload);
+    // Runs `action` after the configured latency (immediately if none).
+    void delayed(std::function<void()> action);
+
+    Config config_;
+    ServerType server_;
+    std::unique_ptr<boost::asio::steady_timer> tickTimer_;
+    std::string certificatePem_;
+    std::string keyPem_;
+
+    // All state below lives on the server's io thread
+    std::mt19937 rng_{7};
+    std::unordered_map<std::string, Book> books_;
+    std::map<websocketpp::connection_hdl, Session, std::owner_less<websocketpp::connection_hdl>> sessions_;
+    std::map<std::string, json> orders_;
+    std::map<std::string, double> positions_;
+    uint64_t nextOrderId_ = 1;
+    int64_t nextTradeSeq_ = 1;
+};
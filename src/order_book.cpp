@@ -0,0 +1,152 @@
+#include "order_book.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+bool parseAction(const std::string& action, BookAction& out) {
+    if (action == "new") out = BookAction::New;
+    else if (action == "change") out = BookAction::Change;
+    else if (action == "delete") out = BookAction::Delete;
+    else return false;
+    return true;
+}
+
+bool parseLevels(const json& levels, std::vector<LevelUpdate>& out) {
+    out.clear();
+    if (!levels.is_array()) return false;
+    out.reserve(levels.size());
+
+    for (const auto& level : levels) {
+        // Book channels send [action, price, amount]
+        if (!level.is_array() || level.size() != 3 || !level[0].is_string()) return false;
+        LevelUpdate update;
+        if (!parseAction(level[0].get_ref<const std::string&>(), update.action)) return false;
+        update.price = level[1].get<double>();
+        update.amount = level[2].get<double>();
+        out.push_back(update);
+    }
+    return true;
+}
+
+// `Better` orders prices best-first, so a side sorted worst-to-best is
+// ascending under !Better: lower_bound finds the level or its insert slot.
+template <typename Better>
+void applyLevel(std::vector<PriceLevel>& side, const LevelUpdate& update, Better better) {
+    auto it = std::lower_bound(side.begin(), side.end(), update.price,
+        [&better](const PriceLevel& level, double price) { return better(price, level.price); });
+    bool found = it != side.end() && it->price == update.price;
+
+    if (update.action == BookAction::Delete || update.amount == 0) {
+        if (found) side.erase(it);
+    } else if (found) {
+        it->amount = update.amount;
+    } else {
+        side.insert(it, PriceLevel{update.price, update.amount});
+    }
+}
+
+} // namespace
+
+bool parseBookUpdate(const json& data, BookUpdate& out) {
+    try {
+        if (!data.contains("bids") || !data.contains("asks") || !data.contains("change_id")) return false;
+
+        out.instrument = data.value("instrument_name", "");
+        out.snapshot = data.value("type", "") == "snapshot";
+        out.changeId = data["change_id"].get<int64_t>();
+        out.prevChangeId = data.value("prev_change_id", int64_t(0));
+        out.timestamp = data.value("timestamp", int64_t(0));
+
+        return parseLevels(data["bids"], out.bids) && parseLevels(data["asks"], out.asks);
+    } catch (const json::exception&) {
+        return false;
+    }
+}
+
+bool parseOrderBookSnapshot(const json& result, BookUpdate& out) {
+    try {
+        if (!result.contains("bids") || !result.contains("asks") || !result.contains("change_id")) return false;
+
+        out.instrument = result.value("instrument_name", "");
+        out.snapshot = true;
+        out.changeId = result["change_id"].get<int64_t>();
+        out.prevChangeId = 0;
+        out.timestamp = result.value("timestamp", int64_t(0));
+
+        auto fill = [](const json& levels, std::vector<LevelUpdate>& side) {
+            side.clear();
+            side.reserve(levels.size());
+            for (const auto& level : levels) {
+                side.push_back(LevelUpdate{BookAction::New, level.at(0).get<double>(), level.at(1).get<double>()});
+            }
+        };
+        fill(result["bids"], out.bids);
+        fill(result["asks"], out.asks);
+        return true;
+    } catch (const json::exception&) {
+        return false;
+    }
+}
+
+OrderBook::OrderBook(std::string instrument) : instrument_(std::move(instrument)) {
+    bids_.reserve(256);
+    asks_.reserve(256);
+}
+
+void OrderBook::apply(const BookUpdate& update) {
+    if (update.snapshot) {
+        clear();
+    }
+
+    for (const auto& level : update.bids) {
+        applyLevel(bids_, level, std::greater<double>());
+    }
+    for (const auto& level : update.asks) {
+        applyLevel(asks_, level, std::less<double>());
+    }
+
+    changeId_ = update.changeId;
+    timestamp_ = update.timestamp;
+}
+
+void OrderBook::clear() {
+    bids_.clear();
+    asks_.clear();
+    changeId_ = 0;
+    timestamp_ = 0;
+}
+
+void OrderBook::snapshot(size_t depth, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const {
+    bids.assign(bids_.rbegin(), bids_.rbegin() + std::min(depth, bids_.size()));
+    asks.assign(asks_.rbegin(), asks_.rbegin() + std::min(depth, asks_.size()));
+}
+
+json bookSnapshotMessage(const std::string& channel, const OrderBook& book) {
+    std::vector<PriceLevel> bids, asks;
+    book.snapshot(std::max(book.bidLevels(), book.askLevels()), bids, asks);
+
+    auto levels = [](const std::vector<PriceLevel>& side) {
+        json out = json::array();
+        for (const auto& level : side) {
+            out.push_back({"new", level.price, level.amount});
+        }
+        return out;
+    };
+
+    return {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {
+            {"channel", channel},
+            {"data", {
+                {"type", "snapshot"},
+                {"instrument_name", book.instrument()},
+                {"change_id", book.changeId()},
+                {"timestamp", book.timestamp()},
+                {"bids", levels(bids)},
+                {"asks", levels(asks)}
+            }}
+        }}
+    };
+}
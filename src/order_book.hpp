@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../json.hpp"
+
+using json = nlohmann::json;
+
+struct PriceLevel {
+    double price;
+    double amount;
+};
+
+enum class BookAction : uint8_t { New, Change, Delete };
+
+struct LevelUpdate {
+    BookAction action;
+    double price;
+    double amount;
+};
+
+// One decoded book.<instrument>.* notification.
+struct BookUpdate {
+    std::string instrument;
+    bool snapshot = false;
+    int64_t changeId = 0;
+    int64_t prevChangeId = 0;
+    int64_t timestamp = 0;
+    std::vector<LevelUpdate> bids;
+    std::vector<LevelUpdate> asks;
+};
+
+// Fills `out` from the "data" object of a book notification.
+// Returns false if the message is not a well-formed book update.
+bool parseBookUpdate(const json& data, BookUpdate& out);
+
+// Fills `out` as a snapshot from the "result" of public/get_order_book,
+// whose levels are plain [price, amount] pairs.
+bool parseOrderBookSnapshot(const json& result, BookUpdate& out);
+
+// L2 book for one instrument.
+//
+// Each side is a flat, sorted array of price levels ordered worst-to-best so
+// the best price sits at the back: top of book is O(1) and the updates that
+// cluster around the touch only shift a handful of levels.
+class OrderBook {
+public:
+    explicit OrderBook(std::string instrument = "");
+
+    // A snapshot replaces the book, a change is applied level by level.
+    void apply(const BookUpdate& update);
+    void clear();
+
+    // nullptr when the side is empty
+    const PriceLevel* bestBid() const { return bids_.empty() ? nullptr : &bids_.back(); }
+    const PriceLevel* bestAsk() const { return asks_.empty() ? nullptr : &asks_.back(); }
+
+    // Copies up to `depth` levels per side, best first.
+    void snapshot(size_t depth, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const;
+
+    const std::string& instrument() const { return instrument_; }
+    int64_t changeId() const { return changeId_; }
+    int64_t timestamp() const { return timestamp_; }
+    size_t bidLevels() const { return bids_.size(); }
+    size_t askLevels() const { return asks_.size(); }
+
+private:
+    std::string instrument_;
+    std::vector<PriceLevel> bids_;  // ascending price, best bid last
+    std::vector<PriceLevel> asks_;  // descending price, best ask last
+    int64_t changeId_ = 0;
+    int64_t timestamp_ = 0;
+};
+
+// Deribit-style "subscription" notification carrying the whole book as a
+// snapshot, used to reset downstream clients after a resync.
+json bookSnapshotMessage(const std::string& channel, const OrderBook& book);
@@ -0,0 +1,212 @@
+#include "order_types.hpp"
+
+using namespace simdjson;
+
+namespace {
+
+Direction decodeDirection(std::string_view value) {
+    if (value == "buy") return Direction::Buy;
+    if (value == "sell") return Direction::Sell;
+    return Direction::Zero;
+}
+
+OrderState decodeState(std::string_view value) {
+    if (value == "open") return OrderState::Open;
+    if (value == "filled") return OrderState::Filled;
+    if (value == "rejected") return OrderState::Rejected;
+    if (value == "cancelled") return OrderState::Cancelled;
+    if (value == "untriggered") return OrderState::Untriggered;
+    return OrderState::Unknown;
+}
+
+// Numbers only: market orders report price as "market_price".
+void decodeNumber(ondemand::value& value, double& out) {
+    double number;
+    if (!value.get_double().get(number)) out = number;
+}
+
+void decodeString(ondemand::value& value, std::string_view& out) {
+    if (value.get_string().get(out)) out = std::string_view();
+}
+
+// Walks an order object, or a buy/sell/edit result that wraps one as
+// "order" next to "trades".
+bool decodeOrder(ondemand::object& object, OrderAck& ack) {
+    for (auto fieldResult : object) {
+        ondemand::field field;
+        std::string_view key;
+        if (std::move(fieldResult).get(field) || field.unescaped_key().get(key)) return false;
+        ondemand::value& value = field.value();
+        Order& order = ack.order;
+        std::string_view text;
+
+        if (key == "order") {
+            ondemand::object nested;
+            if (value.get_object().get(nested) || !decodeOrder(nested, ack)) return false;
+        } else if (key == "trades") {
+            ondemand::array trades;
+            if (value.get_array().get(trades)) return false;
+            size_t count = 0;
+            if (trades.count_elements().get(count)) return false;
+            ack.trades = static_cast<uint32_t>(count);
+        } else if (key == "order_id") {
+            decodeString(value, text);
+            order.orderId.assign(text);
+        } else if (key == "instrument_name") {
+            decodeString(value, text);
+            order.instrument.assign(text);
+        } else if (key == "direction") {
+            decodeString(value, text);
+            order.direction = decodeDirection(text);
+        } else if (key == "order_state") {
+            decodeString(value, text);
+            order.state = decodeState(text);
+        } else if (key == "price") {
+            decodeNumber(value, order.price);
+        } else if (key == "amount") {
+            decodeNumber(value, order.amount);
+        } else if (key == "filled_amount") {
+            decodeNumber(value, order.filledAmount);
+        } else if (key == "average_price") {
+            decodeNumber(value, order.averagePrice);
+        } else if (key == "last_update_timestamp") {
+            int64_t timestamp;
+            if (!value.get_int64().get(timestamp)) order.lastUpdateTimestamp = timestamp;
+        }
+    }
+    return true;
+}
+
+bool decodeError(ondemand::value& value, OrderAck& ack) {
+    ondemand::object error;
+    if (value.get_object().get(error)) return false;
+    for (auto fieldResult : error) {
+        ondemand::field field;
+        std::string_view key;
+        if (std::move(fieldResult).get(field) || field.unescaped_key().get(key)) return false;
+        if (key == "code") {
+            int64_t code;
+            if (!field.value().get_int64().get(code)) ack.errorCode = code;
+        } else if (key == "message") {
+            std::string_view message;
+            decodeString(field.value(), message);
+            ack.errorMessage.assign(message);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+const char* toString(Direction direction) {
+    switch (direction) {
+    case Direction::Buy: return "buy";
+    case Direction::Sell: return "sell";
+    case Direction::Zero: return "zero";
+    }
+    return "zero";
+}
+
+const char* toString(OrderState state) {
+    switch (state) {
+    case OrderState::Open: return "open";
+    case OrderState::Filled: return "filled";
+    case OrderState::Rejected: return "rejected";
+    case OrderState::Cancelled: return "cancelled";
+    case OrderState::Untriggered: return "untriggered";
+    case OrderState::Unknown: return "unknown";
+    }
+    return "unknown";
+}
+
+std::ostream& operator<<(std::ostream& os, const OrderAck& ack) {
+    if (!ack.ok) {
+        return os << "error " << ack.errorCode << " " << ack.errorMessage.view();
+    }
+    const Order& order = ack.order;
+    return os << order.orderId.view() << " " << toString(order.direction) << " " << order.instrument.view()
+              << " " << toString(order.state) << " amount " << order.amount << " @ " << order.price
+              << ", filled " << order.filledAmount << " @ " << order.averagePrice << " (" << ack.trades
+              << " trades)";
+}
+
+std::ostream& operator<<(std::ostream& os, const Position& position) {
+    return os << position.instrument.view() << " " << toString(position.direction) << " " << position.size
+              << " @ " << position.averagePrice << ", pnl " << position.floatingPnl;
+}
+
+OrderDecoder& OrderDecoder::local() {
+    thread_local OrderDecoder decoder;
+    return decoder;
+}
+
+bool OrderDecoder::iterate(const std::string& body, ondemand::document& doc) {
+    const char* data = body.data();
+    size_t capacity = body.capacity();
+    if (capacity < body.size() + SIMDJSON_PADDING) {
+        padded_.reserve(body.size() + SIMDJSON_PADDING);
+        padded_.assign(body);
+        data = padded_.data();
+        capacity = padded_.capacity();
+    }
+    return !parser_.iterate(data, body.size(), capacity).get(doc);
+}
+
+bool OrderDecoder::decodeAck(const std::string& body, OrderAck& out) {
+    out = OrderAck();
+    ondemand::document doc;
+    ondemand::object root;
+    if (!iterate(body, doc) || doc.get_object().get(root)) {
+        out.errorMessage.assign("malformed response");
+        return false;
+    }
+
+    for (auto fieldResult : root) {
+        ondemand::field field;
+        std::string_view key;
+        if (std::move(fieldResult).get(field) || field.unescaped_key().get(key)) return false;
+        if (key == "result") {
+            ondemand::object result;
+            out.ok = !field.value().get_object().get(result) && decodeOrder(result, out);
+        } else if (key == "error") {
+            decodeError(field.value(), out);
+            out.ok = false;
+        }
+    }
+    return out.ok;
+}
+
+bool OrderDecoder::decodePositions(const std::string& body, std::vector<Position>& out) {
+    out.clear();
+    ondemand::document doc;
+    ondemand::array result;
+    if (!iterate(body, doc) || doc["result"].get_array().get(result)) return false;
+
+    for (auto entry : result) {
+        ondemand::object object;
+        if (entry.get_object().get(object)) return false;
+        Position position;
+        for (auto fieldResult : object) {
+            ondemand::field field;
+            std::string_view key;
+            if (std::move(fieldResult).get(field) || field.unescaped_key().get(key)) return false;
+            ondemand::value& value = field.value();
+            std::string_view text;
+            if (key == "instrument_name") {
+                decodeString(value, text);
+                position.instrument.assign(text);
+            } else if (key == "direction") {
+                decodeString(value, text);
+                position.direction = decodeDirection(text);
+            } else if (key == "size") {
+                decodeNumber(value, position.size);
+            } else if (key == "average_price") {
+                decodeNumber(value, position.averagePrice);
+            } else if (key == "floating_profit_loss") {
+                decodeNumber(value, position.floatingPnl);
+            }
+        }
+        out.push_back(position);
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <simdjson.h>
+
+// Inline, truncating string for short identifiers (order ids, instrument
+// names), so decoded orders carry no heap allocations.
+template <size_t N>
+struct FixedString {
+    char data[N] = {};
+    uint8_t size = 0;
+
+    void assign(std::string_view value) {
+        size = static_cast<uint8_t>(std::min(value.size(), N));
+        std::memcpy(data, value.data(), size);
+    }
+    std::string_view view() const { return std::string_view(data, size); }
+    std::string str() const { return std::string(data, size); }
+    bool empty() const { return size == 0; }
+};
+static_assert(sizeof(FixedString<32>) <= 40, "FixedString should stay small");
+
+enum class Direction : uint8_t { Buy, Sell, Zero };
+enum class OrderState : uint8_t { Open, Filled, Rejected, Cancelled, Untriggered, Unknown };
+
+const char* toString(Direction direction);
+const char* toString(OrderState state);
+
+struct Order {
+    FixedString<32> orderId;
+    FixedString<32> instrument;
+    Direction direction = Direction::Zero;
+    OrderState state = OrderState::Unknown;
+    double price = 0;  // 0 for market orders
+    double amount = 0;
+    double filledAmount = 0;
+    double averagePrice = 0;
+    int64_t lastUpdateTimestamp = 0;
+};
+
+// Result of private/buy, sell, edit or cancel.
+struct OrderAck {
+    bool ok = false;
+    int64_t errorCode = 0;        // Deribit error code; 0 for transport errors
+    FixedString<64> errorMessage;
+    Order order;
+    uint32_t trades = 0;          // fills reported with the response
+};
+
+struct Position {
+    FixedString<32> instrument;
+    Direction direction = Direction::Zero;
+    double size = 0;
+    double averagePrice = 0;
+    double floatingPnl = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const OrderAck& ack);
+std::ostream& operator<<(std::ostream& os, const Position& position);
+
+// Pulls the fields above out of REST responses with simdjson's on-demand API,
+// in one pass and without building a DOM. One decoder per thread.
+class OrderDecoder {
+public:
+    // {"result": {"order": {...}, "trades": [...]}} from buy/sell/edit, or
+    // {"result": {...order...}} from cancel, or {"error": {...}}.
+    bool decodeAck(const std::string& body, OrderAck& out);
+    bool decodePositions(const std::string& body, std::vector<Position>& out);
+
+    // Per-thread instance for callers without a decoder of their own.
+    static OrderDecoder& local();
+
+private:
+    bool iterate(const std::string& body, simdjson::ondemand::document& doc);
+
+    simdjson::ondemand::parser parser_;
+    std::string padded_;  // used when the body has no room for simdjson's padding
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <curl/curl.h>
+
+// Reusable, pre-sized buffer for request URLs. reset() keeps the capacity,
+// so once warm, building a request does not touch the heap. Numbers are
+// written with std::to_chars: doubles in the shortest fixed-notation form
+// that round-trips ("10", "84500.5", "100000"). Never scientific: the '+' in
+// "1e+05" would decode as a space in a query string.
+class RequestBuilder {
+public:
+    explicit RequestBuilder(size_t capacity = 512) { buffer_.reserve(capacity); }
+
+    RequestBuilder& reset() {
+        buffer_.clear();
+        return *this;
+    }
+
+    RequestBuilder& append(std::string_view text) {
+        buffer_.append(text.data(), text.size());
+        return *this;
+    }
+
+    RequestBuilder& append(double value) {
+        char digits[328];  // fixed notation of DBL_MAX is 309 digits
+        auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed);
+        buffer_.append(digits, result.ptr - digits);
+        return *this;
+    }
+
+    RequestBuilder& append(int64_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer_.append(digits, result.ptr - digits);
+        return *this;
+    }
+
+    const std::string& str() const { return buffer_; }
+
+private:
+    std::string buffer_;
+};
+
+// "Authorization: Bearer <token>" as a curl header list, rebuilt only when
+// the token changes (i.e. on refresh), not per request.
+class AuthHeader {
+public:
+    AuthHeader() = default;
+    ~AuthHeader() { curl_slist_free_all(list_); }
+    AuthHeader(const AuthHeader&) = delete;
+    AuthHeader& operator=(const AuthHeader&) = delete;
+
+    struct curl_slist* get(const std::string& token) {
+        if (!list_ || token != token_) {
+            token_ = token;
+            line_.assign("Authorization: Bearer ").append(token);
+            curl_slist_free_all(list_);
+            list_ = curl_slist_append(nullptr, line_.c_str());
+        }
+        return list_;
+    }
+
+private:
+    std::string token_;
+    std::string line_;
+    struct curl_slist* list_ = nullptr;
+};
@@ -0,0 +1,50 @@
+#include "rpc_tracker.hpp"
+
+uint64_t RpcTracker::track(Callback callback) {
+    uint64_t id = nextId_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.emplace(id, std::move(callback));
+    return id;
+}
+
+bool RpcTracker::resolve(uint64_t id, const json& response) {
+    Callback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(id);
+        if (it == pending_.end()) return false;
+        callback = std::move(it->second);
+        pending_.erase(it);
+    }
+    // Run outside the lock so the callback may issue further requests.
+    if (callback) callback(response);
+    return true;
+}
+
+void RpcTracker::fail(uint64_t id, const std::string& reason) {
+    resolve(id, makeError(reason));
+}
+
+void RpcTracker::failAll(const std::string& reason) {
+    std::unordered_map<uint64_t, Callback> failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed.swap(pending_);
+    }
+    json error = makeError(reason);
+    for (auto& entry : failed) {
+        if (entry.second) entry.second(error);
+    }
+}
+
+size_t RpcTracker::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+json RpcTracker::makeError(const std::string& reason) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"error", {{"code", -1}, {"message", reason}}}
+    };
+}
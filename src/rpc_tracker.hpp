@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "../json.hpp"
+
+using json = nlohmann::json;
+
+// Correlates outgoing JSON-RPC requests with their responses by request id.
+// Ids start well above the fixed ids used for subscriptions and heartbeats.
+class RpcTracker {
+public:
+    using Callback = std::function<void(const json& response)>;
+
+    // Reserves a fresh id and remembers the callback for it.
+    uint64_t track(Callback callback);
+
+    // Completes the request with this id. Returns false if it is not ours.
+    bool resolve(uint64_t id, const json& response);
+
+    // Completes a single request with a synthetic error response.
+    void fail(uint64_t id, const std::string& reason);
+
+    // Completes every pending request with an error, e.g. on disconnect.
+    void failAll(const std::string& reason);
+
+    size_t pending() const;
+
+    static json makeError(const std::string& reason);
+
+private:
+    mutable std::mutex mutex_;
+    std::atomic<uint64_t> nextId_{100000};
+    std::unordered_map<uint64_t, Callback> pending_;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+//
+// Head and tail live on separate cache lines, and each side keeps a cached
+// copy of the other's index so the shared line is only read when the queue
+// looks full (producer) or empty (consumer).
+template <typename T>
+class SpscQueue {
+public:
+    // Capacity is rounded up to a power of two.
+    explicit SpscQueue(size_t capacity) {
+        size_t rounded = 1;
+        while (rounded < capacity) rounded <<= 1;
+        slots_.resize(rounded);
+        mask_ = rounded - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. Returns false when the queue is full.
+    bool tryPush(T&& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tailCache_ == slots_.size()) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head - tailCache_ == slots_.size()) return false;
+        }
+        slots_[head & mask_] = std::move(item);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false when the queue is empty.
+    bool tryPop(T& out) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == headCache_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail == headCache_) return false;
+        }
+        out = std::move(slots_[tail & mask_]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently; exact from either side.
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    alignas(kCacheLine) std::atomic<size_t> head_{0};  // producer writes
+    size_t tailCache_ = 0;                             // producer's view of tail_
+
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};  // consumer writes
+    size_t headCache_ = 0;                             // consumer's view of head_
+
+    alignas(kCacheLine) std::vector<T> slots_;
+    size_t mask_ = 0;
+};
@@ -0,0 +1,62 @@
+#include "subscription_index.hpp"
+
+bool SubscriptionIndex::subscribe(const ClientPtr& client, const std::string& channel) {
+    if (!byClient_[client->hdl].insert(channel).second) return false;
+    auto it = byChannel_.try_emplace(channel).first;
+    it->second.clients.emplace(client->hdl, client);
+    refresh(it);
+    return true;
+}
+
+bool SubscriptionIndex::unsubscribe(websocketpp::connection_hdl client, const std::string& channel) {
+    auto clientIt = byClient_.find(client);
+    if (clientIt == byClient_.end() || clientIt->second.erase(channel) == 0) return false;
+    if (clientIt->second.empty()) byClient_.erase(clientIt);
+
+    auto channelIt = byChannel_.find(channel);
+    if (channelIt != byChannel_.end()) {
+        channelIt->second.clients.erase(client);
+        refresh(channelIt);
+    }
+    return true;
+}
+
+void SubscriptionIndex::removeClient(websocketpp::connection_hdl client) {
+    auto clientIt = byClient_.find(client);
+    if (clientIt == byClient_.end()) return;
+
+    for (const auto& channel : clientIt->second) {
+        auto channelIt = byChannel_.find(channel);
+        if (channelIt == byChannel_.end()) continue;
+        channelIt->second.clients.erase(client);
+        refresh(channelIt);
+    }
+    byClient_.erase(clientIt);
+}
+
+SubscriptionIndex::SubscriberList SubscriptionIndex::subscribers(const std::string& channel) const {
+    auto it = byChannel_.find(channel);
+    return it == byChannel_.end() ? nullptr : it->second.list;
+}
+
+std::vector<std::string> SubscriptionIndex::channels(websocketpp::connection_hdl client) const {
+    auto it = byClient_.find(client);
+    if (it == byClient_.end()) return {};
+    return std::vector<std::string>(it->second.begin(), it->second.end());
+}
+
+bool SubscriptionIndex::isSubscribed(websocketpp::connection_hdl client, const std::string& channel) const {
+    auto it = byClient_.find(client);
+    return it != byClient_.end() && it->second.count(channel) > 0;
+}
+
+void SubscriptionIndex::refresh(std::unordered_map<std::string, ChannelEntry>::iterator it) {
+    if (it->second.clients.empty()) {
+        byChannel_.erase(it);
+        return;
+    }
+    auto list = std::make_shared<std::vector<ClientPtr>>();
+    list->reserve(it->second.clients.size());
+    for (const auto& client : it->second.clients) list->push_back(client.second);
+    it->second.list = std::move(list);
+}
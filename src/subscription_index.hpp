@@ -0,0 +1,49 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <websocketpp/common/connection_hdl.hpp>
+#include "client_session.hpp"
+
+// Which downstream clients asked for which channels.
+//
+// Lookups go channel -> clients so a notification is only framed and sent
+// when somebody wants it; the reverse map lets a disconnect drop all of a
+// client's subscriptions at once.
+//
+// Each channel's subscribers are also published as an immutable list that is
+// rebuilt on change, so fan-out on another thread can hold a reference to it
+// without copying or locking.
+class SubscriptionIndex {
+public:
+    using ClientMap = std::map<websocketpp::connection_hdl, ClientPtr, std::owner_less<websocketpp::connection_hdl>>;
+    using SubscriberList = std::shared_ptr<const std::vector<ClientPtr>>;
+
+    // Both return false when nothing changed.
+    bool subscribe(const ClientPtr& client, const std::string& channel);
+    bool unsubscribe(websocketpp::connection_hdl client, const std::string& channel);
+    void removeClient(websocketpp::connection_hdl client);
+
+    // nullptr when the channel has no subscribers
+    SubscriberList subscribers(const std::string& channel) const;
+    std::vector<std::string> channels(websocketpp::connection_hdl client) const;
+    bool isSubscribed(websocketpp::connection_hdl client, const std::string& channel) const;
+
+    size_t channelCount() const { return byChannel_.size(); }
+
+private:
+    struct ChannelEntry {
+        ClientMap clients;
+        SubscriberList list;
+    };
+
+    // Drops the channel when its last client leaves, else republishes its list.
+    void refresh(std::unordered_map<std::string, ChannelEntry>::iterator it);
+
+    std::unordered_map<std::string, ChannelEntry> byChannel_;
+    std::map<websocketpp::connection_hdl, std::set<std::string>, std::owner_less<websocketpp::connection_hdl>> byClient_;
+};
@@ -0,0 +1,166 @@
+#include "token_manager.hpp"
+#include "deribit_config.hpp"
+#include "http_pool.hpp"
+#include "latency_histogram.hpp"
+#include "../json.hpp"
+#include <algorithm>
+#include <iostream>
+
+using json = nlohmann::json;
+
+TokenManager::~TokenManager() {
+    stop();
+}
+
+bool TokenManager::start(const std::string& clientId, const std::string& clientSecret) {
+    clientId_ = clientId;
+    clientSecret_ = clientSecret;
+
+    Token token;
+    if (!authenticate("client_id=" + clientId_ + "&client_secret=" + clientSecret_ +
+                      "&grant_type=client_credentials", token)) {
+        return false;
+    }
+    publish(token);
+
+    stopping_ = false;
+    refresher_ = std::thread(&TokenManager::refreshLoop, this);
+    return true;
+}
+
+void TokenManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (refresher_.joinable()) {
+        refresher_.join();
+    }
+}
+
+TokenManager::Lease TokenManager::current() const {
+    // seq_cst pairs the reader-count increment with publish()'s index store
+    // and reader-count check: either the recheck below sees the slot retired,
+    // or the refresh thread sees the reader and leaves the slot alone.
+    while (true) {
+        uint32_t index = current_.load();
+        if (index == kNoSlot) return Lease();
+        Slot& slot = slots_[index];
+        slot.readers.fetch_add(1);
+        if (current_.load() == index) return Lease(&slot);
+        slot.readers.fetch_sub(1);
+    }
+}
+
+TokenManager::Lease& TokenManager::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        slot_ = other.slot_;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+const std::string& TokenManager::Lease::operator*() const {
+    static const std::string empty;
+    return slot_ ? slot_->token.accessToken : empty;
+}
+
+void TokenManager::Lease::release() {
+    if (slot_) slot_->readers.fetch_sub(1);
+    slot_ = nullptr;
+}
+
+void TokenManager::refreshNow() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refreshRequested_ = true;
+    }
+    wake_.notify_all();
+}
+
+bool TokenManager::authenticate(const std::string& query, Token& token) {
+    std::string response;
+    auto sent = std::chrono::steady_clock::now();
+    CURLcode res = pooledGet(DeribitConfig::instance().url("/api/v2/public/auth") + "?" + query, nullptr, response);
+    if (res != CURLE_OK) {
+        std::cerr << "[ERROR] Auth request failed: " << curl_easy_strerror(res) << std::endl;
+        return false;
+    }
+
+    try {
+        ScopedLatency timer(latency("/api/v2/public/auth parse"));
+        json result = json::parse(response).at("result");
+        int64_t expiresIn = result.at("expires_in").get<int64_t>();
+        token.accessToken = result.at("access_token").get<std::string>();
+        token.refreshToken = result.value("refresh_token", "");
+        token.expiresAt = sent + std::chrono::seconds(expiresIn);
+        token.refreshAt = sent + std::chrono::seconds(expiresIn * 4 / 5);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to read token from auth response: " << e.what() << " " << response << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void TokenManager::publish(const Token& token) {
+    // Any slot but the current one that no reader has pinned. Leases are held
+    // for one request, so this only waits if a reader is mid-request on
+    // every retired slot.
+    uint32_t current = current_.load();
+    uint32_t next = kNoSlot;
+    while (next == kNoSlot) {
+        for (uint32_t i = 0; i < kSlots; ++i) {
+            if (i != current && slots_[i].readers.load() == 0) {
+                next = i;
+                break;
+            }
+        }
+        if (next == kNoSlot) std::this_thread::yield();
+    }
+    slots_[next].token = token;
+    current_.store(next);
+}
+
+void TokenManager::refreshLoop() {
+    auto retryDelay = std::chrono::seconds(1);
+    while (true) {
+        const Token* token = &slots_[current_.load()].token;
+        auto refreshAt = token->refreshAt;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_until(lock, refreshAt, [this]() { return stopping_ || refreshRequested_; });
+            if (stopping_) return;
+            refreshRequested_ = false;
+        }
+
+        Token next;
+        bool ok = !token->refreshToken.empty() &&
+                  authenticate("grant_type=refresh_token&refresh_token=" + token->refreshToken, next);
+        if (!ok) {
+            ok = authenticate("client_id=" + clientId_ + "&client_secret=" + clientSecret_ +
+                              "&grant_type=client_credentials", next);
+        }
+
+        if (ok) {
+            publish(next);
+            refreshes_.fetch_add(1, std::memory_order_relaxed);
+            retryDelay = std::chrono::seconds(1);
+            std::cout << "[AUTH] Access token refreshed, valid for "
+                      << std::chrono::duration_cast<std::chrono::seconds>(
+                             next.expiresAt - std::chrono::steady_clock::now()).count()
+                      << " s" << std::endl;
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() >= token->expiresAt) {
+            std::cerr << "[ERROR] Access token expired and could not be renewed" << std::endl;
+        }
+        // Retry the current token's refresh after a backoff
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wake_.wait_for(lock, retryDelay, [this]() { return stopping_; })) return;
+        retryDelay = std::min(retryDelay * 2, std::chrono::seconds(30));
+        refreshRequested_ = true;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Owns the Deribit access token for the whole process.
+//
+// start() authenticates with client credentials. A background thread then
+// renews the token with its refresh_token once 80% of expires_in has passed,
+// so callers never wait on an auth round trip. If the refresh grant is
+// rejected, the thread falls back to client credentials, retrying with backoff.
+//
+// Reads are lock-free and do not allocate. Tokens live in a few preallocated
+// slots and an atomic index names the current one. A reader pins its slot by
+// bumping the slot's reader count, and the refresh thread only rewrites a
+// slot that is neither current nor pinned, however often refreshNow() fires.
+class TokenManager {
+    struct Slot;
+
+public:
+    // Pins the token that was current when it was taken; valid until destroyed.
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept : slot_(other.slot_) { other.slot_ = nullptr; }
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() { release(); }
+
+        const std::string& operator*() const;
+        const std::string* operator->() const { return &**this; }
+
+    private:
+        friend class TokenManager;
+        explicit Lease(Slot* slot) : slot_(slot) {}
+        void release();
+
+        Slot* slot_ = nullptr;
+    };
+
+    TokenManager() = default;
+    ~TokenManager();
+    TokenManager(const TokenManager&) = delete;
+    TokenManager& operator=(const TokenManager&) = delete;
+
+    // Blocks for the first token. Returns false (and logs) if that fails.
+    bool start(const std::string& clientId, const std::string& clientSecret);
+    void stop();
+
+    // Current access token, or "" before start() succeeds. Pins the published
+    // token instead of copying it, so reading it per order does not allocate.
+    Lease current() const;
+    // Wakes the refresh thread now, e.g. after the exchange answered
+    // "unauthorized". Does not wait for the new token.
+    void refreshNow();
+
+    uint64_t refreshes() const { return refreshes_.load(std::memory_order_relaxed); }
+
+private:
+    struct Token {
+        std::string accessToken;
+        std::string refreshToken;
+        std::chrono::steady_clock::time_point refreshAt;
+        std::chrono::steady_clock::time_point expiresAt;
+    };
+
+    struct Slot {
+        Token token;
+        std::atomic<uint32_t> readers{0};
+    };
+
+    // GET public/auth with `query`; fills `token` from the result.
+    bool authenticate(const std::string& query, Token& token);
+    void publish(const Token& token);
+    void refreshLoop();
+
+    static constexpr size_t kSlots = 4;
+    static constexpr uint32_t kNoSlot = kSlots;
+
+    std::string clientId_;
+    std::string clientSecret_;
+
+    // Written by start() and then the refresh thread only, which may read the
+    // current slot without pinning it: it never rewrites that one.
+    mutable std::array<Slot, kSlots> slots_;
+    std::atomic<uint32_t> current_{kNoSlot};
+    std::atomic<uint64_t> refreshes_{0};
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    bool refreshRequested_ = false;
+    std::thread refresher_;
+};
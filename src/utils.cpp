@@ -5,48 +5,45 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <charconv>
+#include <cmath>
 #include "utils.hpp"
 #include <curl/curl.h>
 #include "../json.hpp"
 #include <fstream>
 #include <chrono>
+#include "http_pool.hpp"
+#include "async_http.hpp"
+#include "order_types.hpp"
+#include "request_builder.hpp"
+#include "deribit_config.hpp"
+#include "async_logger.hpp"
+#include "latency_histogram.hpp"
 
 
 using json = nlohmann::json;
 
 
+// json::parse with the time recorded under "<endpoint> parse".
+static json parseTimed(const std::string& body, const std::string& endpoint) {
+    ScopedLatency timer(latency(endpoint + " parse"));
+    return json::parse(body);
+}
+
 void logBenchmark(const std::string& message) {
-    std::ofstream logFile("benchmark.log", std::ios_base::app);
-    if (logFile.is_open()) {
-        logFile << message << std::endl;
-        logFile.close();
-    }
+    AsyncLogger::instance().logLine(LogLevel::Info, LogRecord::BenchmarkFile, message);
 }
 
 std::string makeAuthenticatedRequest(const std::string& endpoint, const std::string& accessToken) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return "";
-
     std::string response;
-    std::string url = "https://test.deribit.com" + endpoint;
-    std::cout << "[KEY] Access Token: " << accessToken << std::endl;
+    std::string url = DeribitConfig::instance().url(endpoint);
+    LOG_DEBUG("[KEY] Access Token: {}", accessToken);
     struct curl_slist* headers = NULL;
     headers = curl_slist_append(headers, ("Authorization: Bearer " + accessToken).c_str());
     headers = curl_slist_append(headers, "Content-Type: application/json");
 
-    auto start = std::chrono::high_resolution_clock::now();
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    CURLcode res = pooledGet(url, headers, response);
 
-    CURLcode res = curl_easy_perform(curl);
-
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
-
-    curl_easy_cleanup(curl);
     curl_slist_free_all(headers);
 
     if (res != CURLE_OK) {
@@ -54,13 +51,9 @@ std::string makeAuthenticatedRequest(const std::string& endpoint, const std::str
         return "";
     }
 
-    std::string logMsg = "[TIME] API Call (" + endpoint + ") took " + std::to_string(duration.count()) + " ms";
-    logBenchmark(logMsg);
-    std::cout << logMsg << std::endl;
-
     return response;
 }
-std::string getEnvValue(const std::string& key) {
+static bool findEnvValue(const std::string& key, std::string& result) {
     std::vector<std::filesystem::path> possiblePaths = {
         ".env",                           
         "../.env",                        
@@ -86,16 +79,64 @@ std::string getEnvValue(const std::string& key) {
                         // Trim whitespace from value
                         value.erase(0, value.find_first_not_of(" \t"));
                         value.erase(value.find_last_not_of(" \t") + 1);
-                        return value;
+                        result = value;
+                        return true;
                     }
                 }
             }
         }
     }
-    
+    return false;
+}
+
+std::string getEnvValue(const std::string& key) {
+    std::string value;
+    if (findEnvValue(key, value)) return value;
+
     std::cerr << "Error: Key '" << key << "' not found in any .env file" << std::endl;
     return "";
 }
+
+std::string getEnvValueOr(const std::string& key, const std::string& fallback) {
+    std::string value;
+    return findEnvValue(key, value) ? value : fallback;
+}
+
+long getEnvNumberOr(const std::string& key, long fallback, long minValue) {
+    std::string text;
+    if (!findEnvValue(key, text)) return fallback;
+    text.erase(text.find_last_not_of("\r") + 1);  // CRLF .env files
+
+    long value = 0;
+    if (!parseNumber(text, value) || value < minValue) {
+        std::cerr << "[CONFIG] Invalid " << key << " '" << text << "', using " << fallback << std::endl;
+        return fallback;
+    }
+    return value;
+}
+
+bool parseNumber(const std::string& text, long& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool parseNumber(const std::string& text, double& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size() &&
+           std::isfinite(value);
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream iss(list);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
 size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* output) {
     size_t totalSize = size * nmemb;
     output->append((char*)contents, totalSize);
@@ -103,37 +144,19 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* out
 }
 
 std::string getAccessToken(const std::string& client_id, const std::string& client_secret) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return "";
-
     std::string response;
-    std::string url = "https://test.deribit.com/api/v2/public/auth?client_id=" + client_id + 
+    std::string url = DeribitConfig::instance().restUrl + "/api/v2/public/auth?client_id=" + client_id + 
                       "&client_secret=" + client_secret + "&grant_type=client_credentials";
 
-    auto start = std::chrono::high_resolution_clock::now();
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
-
-    curl_easy_cleanup(curl);
+    CURLcode res = pooledGet(url, nullptr, response);
 
     if (res != CURLE_OK) {
         std::cerr << "[ERROR] Curl request failed: " << curl_easy_strerror(res) << std::endl;
         return "";
     }
 
-    std::string logMsg = "[TIME] Access Token Request took " + std::to_string(duration.count()) + " ms";
-    logBenchmark(logMsg);
-    std::cout << logMsg << std::endl;
-
     try {
-        json jsonResponse = json::parse(response);
+        json jsonResponse = parseTimed(response, "/api/v2/public/auth");
         if (jsonResponse.contains("result") && jsonResponse["result"].contains("access_token")) {
             std::string token = jsonResponse["result"]["access_token"];
             std::cout << "[MSG] Extracted Access Token: " << token << std::endl;
@@ -150,253 +173,257 @@ std::string getAccessToken(const std::string& client_id, const std::string& clie
 
 
 
-std::string placeBuyOrder(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return "";
+// Order URLs share one buffer per thread (each thread drives its own pooled
+// connection), so building them does not allocate once it is warm.
+static RequestBuilder& requestBuffer() {
+    thread_local RequestBuilder builder;
+    return builder.reset();
+}
 
-    std::string response;
-    std::string url = "https://test.deribit.com/api/v2/private/buy?"
-                      "instrument_name=" + instrument +
-                      "&amount=" + std::to_string(amount) +
-                      "&type=" + orderType;
+const std::string& orderUrl(const std::string& side, const std::string& instrument, double amount, double price, const std::string& orderType) {
+    RequestBuilder& url = requestBuffer();
+    url.append(DeribitConfig::instance().restUrl).append("/api/v2/private/").append(side)
+       .append("?instrument_name=").append(instrument)
+       .append("&amount=").append(amount)
+       .append("&type=").append(orderType);
 
     if (orderType == "limit") {
-        url += "&price=" + std::to_string(price);
+        url.append("&price=").append(price);
     }
+    return url.str();
+}
 
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, ("Authorization: Bearer " + accessToken).c_str());
+const std::string& cancelUrl(const std::string& orderId) {
+    return requestBuffer().append(DeribitConfig::instance().restUrl)
+        .append("/api/v2/private/cancel?order_id=").append(orderId).str();
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
+const std::string& editUrl(const std::string& orderId, double newAmount, double newPrice) {
+    return requestBuffer().append(DeribitConfig::instance().restUrl)
+        .append("/api/v2/private/edit?order_id=").append(orderId)
+        .append("&amount=").append(newAmount)
+        .append("&price=").append(newPrice).str();
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+static std::string orderBookUrl(const std::string& instrument, int depth) {
+    return DeribitConfig::instance().restUrl + "/api/v2/public/get_order_book?"
+           "instrument_name=" + instrument + "&depth=" + std::to_string(depth);
+}
 
-    CURLcode res = curl_easy_perform(curl);
+static std::string positionsUrl(const std::string& currency, const std::string& kind) {
+    return DeribitConfig::instance().restUrl + "/api/v2/private/get_positions?"
+           "currency=" + currency +
+           "&kind=" + kind;
+}
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
+// Sends an order request and decodes the acknowledgement in one pass.
+static OrderAck orderRequest(const std::string& url, const std::string& accessToken, LatencyHistogram& parseLatency) {
+    // Reused per thread so the order path does not reallocate the body
+    thread_local std::string response;
+    thread_local AuthHeader auth;
+    response.clear();
 
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
+    CURLcode res = pooledGet(url, auth.get(accessToken), response);
 
+    OrderAck ack;
     if (res != CURLE_OK) {
         std::cerr << "[ERROR] Curl request failed: " << curl_easy_strerror(res) << std::endl;
-        return "";
+        ack.errorMessage.assign(curl_easy_strerror(res));
+        return ack;
     }
 
-    std::string logMsg = "[TIME] Buy Order took " + std::to_string(duration.count()) + " ms";
-    logBenchmark(logMsg);
-    std::cout << logMsg << std::endl;
-
-    return response;
+    ScopedLatency timer(parseLatency);
+    if (!OrderDecoder::local().decodeAck(response, ack) && ack.errorCode == 0) {
+        std::cerr << "[ERROR] Unexpected order response: " << response << std::endl;
+    }
+    return ack;
 }
 
-std::string cancelOrder(const std::string& accessToken, const std::string& orderId) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return "";
-
-    std::string response;
-    std::string url = "https://test.deribit.com/api/v2/private/cancel?order_id=" + orderId;
-
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, ("Authorization: Bearer " + accessToken).c_str());
-
-    auto start = std::chrono::high_resolution_clock::now();
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
-
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
-
-    if (res != CURLE_OK) {
-        std::cerr << "[ERROR] Curl request failed: " << curl_easy_strerror(res) << std::endl;
-        return "";
-    }
+OrderAck placeBuyOrder(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType) {
+    static LatencyHistogram& parse = latency("/api/v2/private/buy parse");
+    return orderRequest(orderUrl("buy", instrument, amount, price, orderType), accessToken, parse);
+}
 
-    std::string logMsg = "[TIME] Cancel Order took " + std::to_string(duration.count()) + " ms";
-    logBenchmark(logMsg);
-    std::cout << logMsg << std::endl;
+OrderAck cancelOrder(const std::string& accessToken, const std::string& orderId) {
+    static LatencyHistogram& parse = latency("/api/v2/private/cancel parse");
+    return orderRequest(cancelUrl(orderId), accessToken, parse);
+}
 
-    return response;
+OrderAck modifyOrder(const std::string& accessToken, const std::string& orderId, double newAmount, double newPrice) {
+    static LatencyHistogram& parse = latency("/api/v2/private/edit parse");
+    return orderRequest(editUrl(orderId, newAmount, newPrice), accessToken, parse);
 }
-std::string modifyOrder(const std::string& accessToken, const std::string& orderId, double newAmount, double newPrice) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return "";
 
-    auto start = std::chrono::high_resolution_clock::now();
+OrderAck placeSellOrder(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType) {
+    static LatencyHistogram& parse = latency("/api/v2/private/sell parse");
+    return orderRequest(orderUrl("sell", instrument, amount, price, orderType), accessToken, parse);
+}
 
+json getMarketData(const std::string& currency, const std::string& kind, const std::string& instrument, int depth) {
+    json finalResponse;
     std::string response;
-    std::string url = "https://test.deribit.com/api/v2/private/edit?"
-                      "order_id=" + orderId +
-                      "&amount=" + std::to_string(newAmount) +
-                      "&price=" + std::to_string(newPrice);
-
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, ("Authorization: Bearer " + accessToken).c_str());
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
+    CURLcode res;
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
+    res = pooledGet(orderBookUrl(instrument, depth), nullptr, response);
 
-    if (res != CURLE_OK) {
-        std::cerr << "Curl request failed: " << curl_easy_strerror(res) << std::endl;
-        return "";
+    if (res == CURLE_OK) {
+        // Never throws: an HTML error page or truncated body is a failed fetch
+        static LatencyHistogram& parse = latency("/api/v2/public/get_order_book parse");
+        json book;
+        {
+            ScopedLatency timer(parse);
+            book = json::parse(response, nullptr, false);
+        }
+        if (book.is_discarded()) {
+            std::cerr << "[ERROR] Order book response is not JSON (" << response.size() << " bytes)" << std::endl;
+        } else {
+            finalResponse["orderbook"] = std::move(book);
+        }
+    } else {
+        std::cerr << "[ERROR] Error fetching order book: " << curl_easy_strerror(res) << std::endl;
     }
 
-    std::string logMsg = "[TIME] Modify Order took " + std::to_string(duration.count()) + " ms";
-    logBenchmark(logMsg);
-    std::cout << logMsg << std::endl;
-    return response;
+    return finalResponse;
 }
 
-std::string placeSellOrder(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return "";
-    auto start = std::chrono::high_resolution_clock::now();
-
+std::vector<Position> getPositions(const std::string& accessToken, const std::string& currency, const std::string& kind) {
+    std::vector<Position> positions;
     std::string response;
-    std::string url = "https://test.deribit.com/api/v2/private/sell?"
-                      "instrument_name=" + instrument +
-                      "&amount=" + std::to_string(amount) +
-                      "&type=" + orderType;
-
-    if (orderType == "limit") {
-        url += "&price=" + std::to_string(price);
-    }
+    std::string url = positionsUrl(currency, kind);
 
     struct curl_slist* headers = NULL;
     headers = curl_slist_append(headers, ("Authorization: Bearer " + accessToken).c_str());
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    CURLcode res = pooledGet(url, headers, response);
     curl_slist_free_all(headers);
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
-
-    std::string logMsg = "[TIME] Place Sell Order took " + std::to_string(duration.count()) + " ms";
-    logBenchmark(logMsg);
-    std::cout << logMsg << std::endl;
     if (res != CURLE_OK) {
         std::cerr << "Curl request failed: " << curl_easy_strerror(res) << std::endl;
-        return "";
+        return positions;
     }
 
-
-    try {
-        json jsonResponse = json::parse(response);
-        if (jsonResponse.contains("result") && jsonResponse["result"].contains("order") && jsonResponse["result"]["order"].contains("order_id")) {
-            return jsonResponse["result"]["order"]["order_id"];
-        } else {
-            std::cerr << "Error: Could not extract order_id from response: " << response << std::endl;
-            return "";
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "JSON Parsing Error: " << e.what() << std::endl;
-        return "";
+    ScopedLatency timer(latency("/api/v2/private/get_positions parse"));
+    if (!OrderDecoder::local().decodePositions(response, positions)) {
+        std::cerr << "Error: Could not read positions from response: " << response << std::endl;
     }
+    return positions;
 }
 
-json getMarketData(const std::string& currency, const std::string& kind, const std::string& instrument, int depth) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return json();
-
-    json finalResponse;
-    std::string response;
-    CURLcode res;
-
-    auto start = std::chrono::high_resolution_clock::now();
-
-    std::string orderBookUrl = "https://test.deribit.com/api/v2/public/get_order_book?"
-                               "instrument_name=" + instrument + "&depth=" + std::to_string(depth);
-
-    curl_easy_setopt(curl, CURLOPT_URL, orderBookUrl.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    res = curl_easy_perform(curl);
+static void asyncGet(const std::string& url, const std::string& accessToken, AsyncHttpClient::Callback callback) {
+    std::vector<std::string> headers;
+    if (!accessToken.empty()) headers.push_back("Authorization: Bearer " + accessToken);
+    AsyncHttpClient::instance().get(url, headers, std::move(callback));
+}
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
+// Decodes on the curl loop thread, so the future resolves to a typed ack.
+static std::future<OrderAck> asyncOrder(const std::string& url, const std::string& accessToken, LatencyHistogram& parseLatency) {
+    auto promise = std::make_shared<std::promise<OrderAck>>();
+    std::future<OrderAck> future = promise->get_future();
+    asyncGet(url, accessToken, [promise, &parseLatency](HttpResponse&& response) {
+        OrderAck ack;
+        if (response.result != CURLE_OK) {
+            LOG_ERROR("[ERROR] Curl request failed: {}", curl_easy_strerror(response.result));
+            ack.errorMessage.assign(curl_easy_strerror(response.result));
+        } else {
+            ScopedLatency timer(parseLatency);
+            OrderDecoder::local().decodeAck(response.body, ack);
+        }
+        promise->set_value(ack);
+    });
+    return future;
+}
 
-    if (res == CURLE_OK) {
-        finalResponse["orderbook"] = json::parse(response);
-    } else {
-        std::cerr << "[ERROR] Error fetching order book: " << curl_easy_strerror(res) << std::endl;
-    }
+std::future<OrderAck> placeBuyOrderAsync(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType) {
+    static LatencyHistogram& parse = latency("/api/v2/private/buy parse");
+    return asyncOrder(orderUrl("buy", instrument, amount, price, orderType), accessToken, parse);
+}
 
-    curl_easy_cleanup(curl);
+std::future<OrderAck> placeSellOrderAsync(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType) {
+    static LatencyHistogram& parse = latency("/api/v2/private/sell parse");
+    return asyncOrder(orderUrl("sell", instrument, amount, price, orderType), accessToken, parse);
+}
 
-    std::string logMsg = "[TIME] Market Data Fetch took " + std::to_string(duration.count()) + " ms";
-    logBenchmark(logMsg);
-    std::cout << logMsg << std::endl;
+std::future<OrderAck> modifyOrderAsync(const std::string& accessToken, const std::string& orderId, double newAmount, double newPrice) {
+    static LatencyHistogram& parse = latency("/api/v2/private/edit parse");
+    return asyncOrder(editUrl(orderId, newAmount, newPrice), accessToken, parse);
+}
 
-    return finalResponse;
+std::future<OrderAck> cancelOrderAsync(const std::string& accessToken, const std::string& orderId) {
+    static LatencyHistogram& parse = latency("/api/v2/private/cancel parse");
+    return asyncOrder(cancelUrl(orderId), accessToken, parse);
 }
 
-json getPositions(const std::string& accessToken, const std::string& currency, const std::string& kind) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return json();
+// Resolves to the response body, or "" (logged) on a transport error.
+std::future<std::string> getOrderBookAsync(const std::string& instrument, int depth) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    asyncGet(orderBookUrl(instrument, depth), "", [promise](HttpResponse&& response) {
+        if (response.result != CURLE_OK) {
+            LOG_ERROR("[ERROR] Curl request failed: {}", curl_easy_strerror(response.result));
+            response.body.clear();
+        }
+        promise->set_value(std::move(response.body));
+    });
+    return future;
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
+std::future<std::vector<Position>> getPositionsAsync(const std::string& accessToken, const std::string& currency, const std::string& kind) {
+    auto promise = std::make_shared<std::promise<std::vector<Position>>>();
+    std::future<std::vector<Position>> future = promise->get_future();
+    asyncGet(positionsUrl(currency, kind), accessToken, [promise](HttpResponse&& response) {
+        std::vector<Position> positions;
+        if (response.result != CURLE_OK) {
+            LOG_ERROR("[ERROR] Curl request failed: {}", curl_easy_strerror(response.result));
+        } else {
+            OrderDecoder::local().decodePositions(response.body, positions);
+        }
+        promise->set_value(std::move(positions));
+    });
+    return future;
+}
 
+std::vector<std::string> getInstruments(const std::string& currency, const std::string& kind) {
+    std::vector<std::string> instruments;
     std::string response;
-    std::string url = "https://test.deribit.com/api/v2/private/get_positions?"
+    std::string url = DeribitConfig::instance().restUrl + "/api/v2/public/get_instruments?"
                       "currency=" + currency +
-                      "&kind=" + kind;
-
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, ("Authorization: Bearer " + accessToken).c_str());
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
-
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
-
-    std::string logMsg = "[TIME] Get Positions took " + std::to_string(duration.count()) + " ms";
-    logBenchmark(logMsg);
-    std::cout << logMsg << std::endl;
+                      "&kind=" + kind +
+                      "&expired=false";
 
+    CURLcode res = pooledGet(url, nullptr, response);
 
     if (res != CURLE_OK) {
         std::cerr << "Curl request failed: " << curl_easy_strerror(res) << std::endl;
-        return json();
+        return instruments;
     }
 
     try {
-        return json::parse(response);
+        json jsonResponse = parseTimed(response, "/api/v2/public/get_instruments");
+        for (const auto& instrument : jsonResponse.at("result")) {
+            instruments.push_back(instrument.at("instrument_name").get<std::string>());
+        }
     } catch (const std::exception& e) {
         std::cerr << "JSON Parsing Error: " << e.what() << std::endl;
-        return json();
     }
+    return instruments;
+}
+
+std::vector<std::string> loadInstrumentUniverse() {
+    // An explicit list wins over discovery
+    std::vector<std::string> instruments = splitList(getEnvValueOr("DERIBIT_INSTRUMENTS", ""));
+    if (!instruments.empty()) return instruments;
+
+    std::vector<std::string> currencies = splitList(getEnvValueOr("DERIBIT_CURRENCIES", ""));
+    std::vector<std::string> kinds = splitList(getEnvValueOr("DERIBIT_KINDS", "future"));
+    for (const auto& currency : currencies) {
+        for (const auto& kind : kinds) {
+            std::vector<std::string> found = getInstruments(currency, kind);
+            instruments.insert(instruments.end(), found.begin(), found.end());
+        }
+    }
+
+    if (instruments.empty()) {
+        instruments.push_back("BTC-PERPETUAL");
+    }
+    return instruments;
 }
\ No newline at end of file
@@ -1,20 +1,53 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
+#include <future>
 #include <string>
+#include <vector>
 #include "../json.hpp"
+#include "order_types.hpp"
 using json = nlohmann::json;
 
+void logBenchmark(const std::string& message);
 size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* output);
 std::string makeAuthenticatedRequest(const std::string& endpoint, const std::string& accessToken);
 std::string getEnvValue(const std::string& key);
+std::string getEnvValueOr(const std::string& key, const std::string& fallback);
+// Whole number from .env. A missing value gives `fallback`; one that is not a
+// number or is below `minValue` is reported as [CONFIG] and gives `fallback`.
+long getEnvNumberOr(const std::string& key, long fallback, long minValue = 0);
+// The whole of `text` as a number; false for empty, trailing or out-of-range text.
+bool parseNumber(const std::string& text, long& value);
+bool parseNumber(const std::string& text, double& value);
+std::vector<std::string> splitList(const std::string& list);
 std::string getAccessToken(const std::string& client_id, const std::string& client_secret);
-std::string placeBuyOrder(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType);
-std::string cancelOrder(const std::string& accessToken, const std::string& orderId);
-std::string cancelOrder(const std::string& accessToken, const std::string& orderId);
-std::string placeSellOrder(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType);
-std::string modifyOrder(const std::string& accessToken, const std::string& orderId, double newAmount, double newPrice);
+// Order request URLs, built in a buffer per thread. The reference is only
+// valid until the next call on the same thread.
+const std::string& orderUrl(const std::string& side, const std::string& instrument, double amount, double price, const std::string& orderType);
+const std::string& cancelUrl(const std::string& orderId);
+const std::string& editUrl(const std::string& orderId, double newAmount, double newPrice);
+
+// Order calls return the decoded acknowledgement; ack.ok is false on a
+// transport error (errorCode 0) or an exchange error (Deribit's code).
+OrderAck placeBuyOrder(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType);
+OrderAck cancelOrder(const std::string& accessToken, const std::string& orderId);
+OrderAck placeSellOrder(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType);
+OrderAck modifyOrder(const std::string& accessToken, const std::string& orderId, double newAmount, double newPrice);
 json getMarketData(const std::string& currency, const std::string& kind, const std::string& instrument, int depth);
-json getPositions(const std::string& accessToken, const std::string& currency, const std::string& kind);
+std::vector<Position> getPositions(const std::string& accessToken, const std::string& currency, const std::string& kind);
+std::vector<std::string> getInstruments(const std::string& currency, const std::string& kind);
+
+// Non-blocking versions of the calls above over one shared curl multi loop.
+// The order book resolves to the raw response body, or "" on a transport error.
+std::future<OrderAck> placeBuyOrderAsync(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType);
+std::future<OrderAck> placeSellOrderAsync(const std::string& accessToken, const std::string& instrument, double amount, double price, const std::string& orderType);
+std::future<OrderAck> modifyOrderAsync(const std::string& accessToken, const std::string& orderId, double newAmount, double newPrice);
+std::future<OrderAck> cancelOrderAsync(const std::string& accessToken, const std::string& orderId);
+std::future<std::string> getOrderBookAsync(const std::string& instrument, int depth);
+std::future<std::vector<Position>> getPositionsAsync(const std::string& accessToken, const std::string& currency, const std::string& kind);
+
+// Instruments to stream, from .env: DERIBIT_INSTRUMENTS (comma list), or every
+// live instrument of DERIBIT_CURRENCIES x DERIBIT_KINDS. Defaults to BTC-PERPETUAL.
+std::vector<std::string> loadInstrumentUniverse();
 
 #endif  // UTILS_HPP
@@ -1,144 +1,626 @@
 #include "websocket_server.hpp"
+#include "utils.hpp"
+#include "async_logger.hpp"
 #include "../json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <string_view>
 
 using json = nlohmann::json;
 
-WebSocketServer::WebSocketServer() {
+namespace {
+// Levels requested from get_order_book when a book has to be rebuilt
+constexpr int kResyncDepth = 1000;
+constexpr int kResyncAttempts = 3;
+// Backoff between rounds of snapshot attempts: doubles per failed round
+constexpr auto kResyncRetryMinDelay = std::chrono::milliseconds(500);
+constexpr auto kResyncRetryMaxDelay = std::chrono::milliseconds(10000);
+// Channels per public/subscribe request
+constexpr size_t kSubscribeBatch = 100;
+
+// Feed thread idle strategy: spin, then yield, then nap
+constexpr unsigned kFeedSpinIterations = 2000;
+constexpr unsigned kFeedYieldIterations = 20000;
+constexpr auto kFeedStatsInterval = std::chrono::seconds(10);
+
+// How often backlogged clients are retried, and client buffer stats logged
+constexpr auto kBackpressureInterval = std::chrono::milliseconds(50);
+constexpr auto kClientStatsInterval = std::chrono::seconds(10);
+
+// Deribit reconnect backoff: doubles per failed attempt, reset once open
+constexpr auto kReconnectMinDelay = std::chrono::milliseconds(500);
+constexpr auto kReconnectMaxDelay = std::chrono::milliseconds(5000);
+
+int64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Wraps a payload as an inbound Deribit message for the feed queue
+WebsocketClientType::message_ptr makeFeedMessage(const char* data, size_t size) {
+    auto msg = std::make_shared<WebsocketClientType::message_type>(
+        WebsocketClientType::message_type::con_msg_man_ptr(), websocketpp::frame::opcode::text, size);
+    msg->set_payload(data, size);
+    return msg;
+}
+
+// Deribit puts "method" ahead of "params", so a notification is recognisable
+// from the first few bytes. Anything else is a control frame.
+bool isSubscriptionNotification(const std::string& payload) {
+    constexpr size_t kPrefix = 64;
+    std::string_view head(payload.data(), std::min(payload.size(), kPrefix));
+    return head.find("\"method\":\"subscription\"") != std::string_view::npos;
+}
+
+// "ws <method> round_trip", looked up once per method and thread so steady
+// state RPCs skip the registry lock and the name concatenation.
+LatencyHistogram& roundTripFor(const std::string& method) {
+    thread_local std::map<std::string, LatencyHistogram*, std::less<>> cache;
+    auto it = cache.find(method);
+    if (it == cache.end()) {
+        it = cache.emplace(method, &latency("ws " + method + " round_trip")).first;
+    }
+    return *it->second;
+}
+
+void pinToCore(unsigned index) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cores, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        std::cerr << "[ERROR] Could not pin server thread to core " << index % cores << ": "
+                  << std::strerror(rc) << std::endl;
+    }
+}
+
+json histogramSummary(const LatencyHistogram& h) {
+    auto us = [](int64_t ns) { return ns / 1000.0; };
+    return {{"count", h.count()}, {"mean_us", h.mean() / 1000.0},
+            {"p50_us", us(h.percentile(50))}, {"p90_us", us(h.percentile(90))},
+            {"p99_us", us(h.percentile(99))}, {"p99_9_us", us(h.percentile(99.9))},
+            {"max_us", us(h.max())}};
+}
+}
+
+WebSocketServer::WebSocketServer(const std::string& deribitUrl)
+    : deribitUrl_(deribitUrl) {
     wsServer_.init_asio();
 
     wsServer_.set_open_handler(std::bind(&WebSocketServer::onOpen, this, std::placeholders::_1));
     wsServer_.set_close_handler(std::bind(&WebSocketServer::onClose, this, std::placeholders::_1));
+    wsServer_.set_message_handler(std::bind(&WebSocketServer::onMessage, this,
+                                            std::placeholders::_1, std::placeholders::_2));
+
+    // The Deribit client is set up once here; init_asio() may not run again
+    // on the reconnect path.
+    deribitClient_.clear_access_channels(websocketpp::log::alevel::all);
+    deribitClient_.set_access_channels(websocketpp::log::alevel::connect);
+    deribitClient_.set_access_channels(websocketpp::log::alevel::disconnect);
+    deribitClient_.set_access_channels(websocketpp::log::alevel::app);
+
+    deribitClient_.init_asio();
+
+    deribitClient_.set_tls_init_handler([](websocketpp::connection_hdl) {
+        auto ctx = std::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tlsv12);
+        ctx->set_options(boost::asio::ssl::context::default_workarounds |
+                         boost::asio::ssl::context::no_sslv2 |
+                         boost::asio::ssl::context::no_sslv3 |
+                         boost::asio::ssl::context::single_dh_use);
+        return ctx;
+    });
+
+    deribitClient_.set_message_handler(std::bind(
+        &WebSocketServer::handleDeribitMessage, this, 
+        std::placeholders::_1, std::placeholders::_2
+    ));
+
+    serverStrand_ = std::make_unique<boost::asio::io_service::strand>(wsServer_.get_io_service());
+
+    restWork_ = std::make_unique<boost::asio::io_service::work>(restService_);
+    restThread_ = std::thread([this]() {
+        // One throwing handler must not take the server down; keep serving
+        while (true) {
+            try {
+                restService_.run();
+                return;
+            } catch (const std::exception& e) {
+                LOG_ERROR("[ERROR] Exception in REST thread: {}", e.what());
+            }
+        }
+    });
+
+    feedWork_ = std::make_unique<boost::asio::io_service::work>(feedService_);
+    feedThread_ = std::thread(&WebSocketServer::runFeedLoop, this);
 }
 
 WebSocketServer::~WebSocketServer() {
     stop();
 }
 
-void WebSocketServer::run(uint16_t port) {
+void WebSocketServer::run(uint16_t port, unsigned threads, bool pinThreads) {
     try {
-        wsServer_.set_reuse_addr(true);
-        wsServer_.listen(port);
-        wsServer_.start_accept();
-        std::cout << "WebSocket Server Running on Port " << port << std::endl;
+        listen(port);
+        std::cout << "WebSocket Server Running on Port " << port << " (" << std::max(1u, threads)
+                  << " threads)" << std::endl;
         
         connectToDeribit();
         
-        wsServer_.run();
+        runServerThreads(threads, pinThreads);
+    } catch (const std::exception& e) {
+        std::cerr << "Error starting WebSocket Server: " << e.what() << std::endl;
+    }
+}
+
+void WebSocketServer::serve(uint16_t port, unsigned threads, bool pinThreads) {
+    try {
+        listen(port);
+        runServerThreads(threads, pinThreads);
     } catch (const std::exception& e) {
         std::cerr << "Error starting WebSocket Server: " << e.what() << std::endl;
     }
 }
 
+void WebSocketServer::listen(uint16_t port) {
+    wsServer_.set_reuse_addr(true);
+    wsServer_.listen(port);
+    wsServer_.start_accept();
+}
+
+void WebSocketServer::runServerThreads(unsigned threads, bool pinThreads) {
+    threads = std::max(1u, threads);
+    serverThreads_ = threads;
+    std::cout << "[CLIENTS] Slow consumers: " << toString(backpressure_.mode) << " above "
+              << backpressure_.maxBufferedBytes / 1024 << " KB buffered" << std::endl;
+    backpressureTimer_ = std::make_unique<boost::asio::steady_timer>(wsServer_.get_io_service());
+    nextClientsLog_ = std::chrono::steady_clock::now() + kClientStatsInterval;
+    scheduleBackpressureCheck();
+
+    auto runLoop = [this, pinThreads](unsigned index) {
+        if (pinThreads) pinToCore(index);
+        try {
+            wsServer_.run();
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] Exception in server thread " << index << ": " << e.what() << std::endl;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) {
+        pool.emplace_back(runLoop, i);
+    }
+    runLoop(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
 void WebSocketServer::stop() {
+    stopping_ = true;
     stopHeartbeat();
-    
-    if (deribitClient_.get_io_service().stopped()) {
-        deribitClient_.get_io_service().restart();
-    }
-    
+
     websocketpp::lib::error_code ec;
-    if (auto conn = deribitConn_.lock()) {
+    if (auto conn = currentDeribitConn()) {
         deribitClient_.close(conn, websocketpp::close::status::normal, "Shutting down", ec);
     }
     
+    deribitClient_.stop_perpetual();
     deribitClient_.stop();
     wsServer_.stop();
     
     if (deribitThread_.joinable()) {
         deribitThread_.join();
     }
+    if (replayThread_.joinable()) {
+        replayThread_.join();
+    }
+    capture_.close();
+
+    feedRunning_ = false;
+    if (feedThread_.joinable()) {
+        feedThread_.join();
+    }
+
+    restWork_.reset();
+    restService_.stop();
+    if (restThread_.joinable()) {
+        restThread_.join();
+    }
 }
 
 void WebSocketServer::onOpen(websocketpp::connection_hdl hdl) {
     std::cout << "Client Connected!" << std::endl;
-    clients_.insert(hdl);
+    websocketpp::lib::error_code ec;
+    auto con = wsServer_.get_con_from_hdl(hdl, ec);
+    auto client = std::make_shared<ClientSession>(hdl, wsServer_.get_io_service(), nextClientId_++,
+                                                  ec ? std::string() : con->get_remote_endpoint());
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    clients_.emplace(hdl, std::move(client));
 }
 
 void WebSocketServer::onClose(websocketpp::connection_hdl hdl) {
     std::cout << "Client Disconnected!" << std::endl;
-    clients_.erase(hdl);
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        clients_.erase(hdl);
+    }
+    feedService_.post([this, hdl]() { subscriptions_.removeClient(hdl); });
+}
+
+ClientPtr WebSocketServer::findClient(websocketpp::connection_hdl hdl) {
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    auto it = clients_.find(hdl);
+    return it == clients_.end() ? nullptr : it->second;
+}
+
+// Client requests: {"id": 1, "method": "subscribe" | "unsubscribe",
+//                   "params": {"channels": ["book.BTC-PERPETUAL.100ms", ...]}}
+// "delivery": "conflated" | "all" in params switches the client between
+// latest-book-only and every update (the default). Trades are never conflated.
+// Plus admin/latency {"prefix": ...} and admin/clients for stats.
+void WebSocketServer::onMessage(websocketpp::connection_hdl hdl, WebsocketServerType::message_ptr msg) {
+    json request = json::parse(msg->get_payload(), nullptr, false);
+    if (request.is_discarded() || !request.is_object()) {
+        sendToClient(hdl, json({{"jsonrpc", "2.0"}, {"error", {{"code", -32700}, {"message", "Parse error"}}}}).dump());
+        return;
+    }
+
+    json id = request.value("id", json());
+    std::string method = request.value("method", "");
+    if (method == "admin/latency") {
+        // Histograms are safe to read from any thread
+        std::string prefix = "tick ";
+        if (request.contains("params") && request["params"].is_object()) {
+            prefix = request["params"].value("prefix", prefix);
+        }
+        sendToClient(hdl, json({{"jsonrpc", "2.0"}, {"id", id}, {"result", latencyReport(prefix)}}).dump());
+        return;
+    }
+    if (method == "admin/clients") {
+        sendToClient(hdl, json({{"jsonrpc", "2.0"}, {"id", id}, {"result", clientReport()}}).dump());
+        return;
+    }
+    if (method != "subscribe" && method != "unsubscribe") {
+        sendToClient(hdl, json({{"jsonrpc", "2.0"}, {"id", id},
+                                {"error", {{"code", -32601}, {"message", "Method not found"}}}}).dump());
+        return;
+    }
+
+    std::vector<std::string> channels;
+    if (request.contains("params") && request["params"].contains("channels") && request["params"]["channels"].is_array()) {
+        for (const auto& channel : request["params"]["channels"]) {
+            if (channel.is_string()) channels.push_back(channel.get<std::string>());
+        }
+    }
+    if (channels.empty()) {
+        sendToClient(hdl, json({{"jsonrpc", "2.0"}, {"id", id},
+                                {"error", {{"code", -32602}, {"message", "params.channels must list channels"}}}}).dump());
+        return;
+    }
+
+    ClientPtr client = findClient(hdl);
+    if (!client) return;  // closed meanwhile
+
+    std::string delivery = request["params"].value("delivery", "");
+    if (delivery == "conflated") client->conflating = true;
+    else if (delivery == "all") client->conflating = false;
+
+    bool subscribe = method == "subscribe";
+    feedService_.post([this, client, id, subscribe, channels]() {
+        updateSubscriptions(client, id, subscribe, channels);
+    });
+}
+
+void WebSocketServer::updateSubscriptions(const ClientPtr& client, const json& id, bool subscribe,
+                                          const std::vector<std::string>& channels) {
+    for (const auto& channel : channels) {
+        if (!subscribe) {
+            subscriptions_.unsubscribe(client->hdl, channel);
+            continue;
+        }
+        if (!subscriptions_.subscribe(client, channel)) continue;
+
+        // Start the new subscriber from a consistent book; deltas follow.
+        auto it = books_.find(channel);
+        if (it != books_.end() && it->second.live()) {
+            postToClient(client, bookSnapshotMessage(channel, it->second.book()).dump());
+        }
+    }
+
+    postToClient(client, json({{"jsonrpc", "2.0"}, {"id", id}, {"result", subscriptions_.channels(client->hdl)}}).dump());
+}
+
+void WebSocketServer::sendToClient(websocketpp::connection_hdl hdl, const std::string& payload) {
+    websocketpp::lib::error_code ec;
+    wsServer_.send(hdl, payload, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        std::cerr << "[ERROR] Error sending to client: " << ec.message() << std::endl;
+    }
 }
+
+void WebSocketServer::postToClient(const ClientPtr& client, std::string payload) {
+    strandFor(client).post([this, client, payload = std::move(payload)]() {
+        sendToClient(client->hdl, payload);
+    });
+}
+
+boost::asio::io_service::strand& WebSocketServer::strandFor(const ClientPtr& client) {
+    // A client's messages must all go through one strand, or a delta could
+    // overtake the snapshot posted just before it.
+    return serverThreads_.load(std::memory_order_relaxed) > 1 ? client->strand : *serverStrand_;
+}
+
 void WebSocketServer::connectToDeribit() {
+    // Reconnects run on the client's own io thread, which must outlive every
+    // connection: keep it running without work and start it only once.
+    deribitClient_.start_perpetual();
+    openDeribitConnection();
+
+    deribitThread_ = std::thread([this]() {
+        try {
+            std::cout << "[MSG] Starting Deribit WebSocket client thread..." << std::endl;
+            deribitClient_.run();
+            std::cout << "Deribit WebSocket client thread ended" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] Error in Deribit WebSocket client thread: " << e.what() << std::endl;
+        }
+    });
+}
+
+void WebSocketServer::openDeribitConnection() {
     try {
         std::cout << "[INIT] Connecting to Deribit WebSocket API..." << std::endl;
-        
-        
-        deribitClient_.clear_access_channels(websocketpp::log::alevel::all);
-        deribitClient_.set_access_channels(websocketpp::log::alevel::connect);
-        deribitClient_.set_access_channels(websocketpp::log::alevel::disconnect);
-        deribitClient_.set_access_channels(websocketpp::log::alevel::app);
-        
-        deribitClient_.init_asio();
-        
-        deribitClient_.set_tls_init_handler([](websocketpp::connection_hdl) {
-            auto ctx = std::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tlsv12);
-            ctx->set_options(boost::asio::ssl::context::default_workarounds |
-                             boost::asio::ssl::context::no_sslv2 |
-                             boost::asio::ssl::context::no_sslv3 |
-                             boost::asio::ssl::context::single_dh_use);
-            return ctx;
-        });
-        
-        deribitClient_.set_message_handler(std::bind(
-            &WebSocketServer::handleDeribitMessage, this, 
-            std::placeholders::_1, std::placeholders::_2
-        ));
-        
+
         websocketpp::lib::error_code ec;
-        auto con = deribitClient_.get_connection("wss://test.deribit.com/ws/api/v2", ec);
-        
+        auto con = deribitClient_.get_connection(deribitUrl_, ec);
         if (ec) {
             std::cerr << "[ERROR] Could not create Deribit connection: " << ec.message() << std::endl;
+            scheduleReconnect();
             return;
         }
-        
+
         con->set_open_handler([this](websocketpp::connection_hdl hdl) {
             std::cout << "[MSG] Deribit WebSocket connection established!" << std::endl;
-            deribitConn_ = hdl;
+            setDeribitConn(hdl);
+            reconnectDelay_ = kReconnectMinDelay;
+            int64_t disconnectedNs = disconnectedNs_.load();
+            if (disconnectedNs != 0) {
+                reconnectOpen_.record(monotonicNs() - disconnectedNs);
+            }
             startHeartbeat();
-            
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            subscribeToOrderbook("BTC-PERPETUAL");
+            // Auth state lives on the feed thread, where RPC responses arrive
+            feedService_.post([this]() { authenticateDeribit(); });
         });
-        
+
         con->set_close_handler([this](websocketpp::connection_hdl) {
             std::cerr << "[STOP] Deribit WebSocket connection closed!" << std::endl;
-            stopHeartbeat();
-            
-            std::cout << "Attempting to reconnect in 3 seconds..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(3));
-            connectToDeribit();
+            onDeribitDisconnected("Deribit connection closed");
         });
-        
+
         con->set_fail_handler([this](websocketpp::connection_hdl) {
             std::cerr << "⚠️ Deribit WebSocket connection failed!" << std::endl;
-            stopHeartbeat();
-            
-            std::cout << "Attempting to reconnect in 5 seconds..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(5));
-            connectToDeribit();
+            onDeribitDisconnected("Deribit connection failed");
         });
-        
+
         deribitClient_.connect(con);
-        
-        // Start the Deribit client thread
-        if (deribitThread_.joinable()) {
-            deribitThread_.join();
-        }
-        
-        deribitThread_ = std::thread([this]() {
-            try {
-                std::cout << "[MSG] Starting Deribit WebSocket client thread..." << std::endl;
-                deribitClient_.run();
-                std::cout << "Deribit WebSocket client thread ended" << std::endl;
-            } catch (const std::exception& e) {
-                std::cerr << "[ERROR] Error in Deribit WebSocket client thread: " << e.what() << std::endl;
-            }
-        });
-        
     } catch (const std::exception& e) {
-        std::cerr << "[ERROR] Exception in connectToDeribit: " << e.what() << std::endl;
+        std::cerr << "[ERROR] Exception in openDeribitConnection: " << e.what() << std::endl;
+    }
+}
+
+void WebSocketServer::onDeribitDisconnected(const std::string& reason) {
+    stopHeartbeat();
+    setDeribitConn(websocketpp::connection_hdl());
+    wsAuthenticated_ = false;
+    rpc_.failAll(reason);
+    if (stopping_) return;
+
+    // Timed from the first drop until the session is back and resubscribed,
+    // across any failed attempts in between.
+    int64_t expected = 0;
+    disconnectedNs_.compare_exchange_strong(expected, monotonicNs());
+    scheduleReconnect();
+}
+
+void WebSocketServer::scheduleReconnect() {
+    if (stopping_) return;
+    auto delay = reconnectDelay_;
+    reconnectDelay_ = std::min(reconnectDelay_ * 2, kReconnectMaxDelay);
+    std::cout << "Attempting to reconnect in " << delay.count() << " ms..." << std::endl;
+
+    // On the client's io thread, instead of sleeping inside its handlers
+    reconnectTimer_ = std::make_shared<boost::asio::steady_timer>(deribitClient_.get_io_service());
+    reconnectTimer_->expires_from_now(delay);
+    reconnectTimer_->async_wait([this](const boost::system::error_code& ec) {
+        if (ec || stopping_) return;
+        openDeribitConnection();
+    });
+}
+
+void WebSocketServer::setCredentials(const std::string& clientId, const std::string& clientSecret) {
+    clientId_ = clientId;
+    clientSecret_ = clientSecret;
+}
+
+void WebSocketServer::authenticateDeribit() {
+    if (clientId_.empty()) {
+        subscribeToOrderbooks(instruments_);
+        return;
+    }
+
+    // A reconnect first tries the refresh token of the previous session
+    bool usedRefresh = !sessionRefreshToken_.empty();
+    json params = usedRefresh
+        ? json({{"grant_type", "refresh_token"}, {"refresh_token", sessionRefreshToken_}})
+        : json({{"grant_type", "client_credentials"}, {"client_id", clientId_}, {"client_secret", clientSecret_}});
+    sendRpc("public/auth", std::move(params), [this, usedRefresh](const json& response) {
+        onDeribitAuth(response, usedRefresh, true);
+    });
+}
+
+void WebSocketServer::onDeribitAuth(const json& response, bool usedRefresh, bool subscribe) {
+    if (!currentDeribitConn()) return;  // dropped meanwhile; the reconnect starts over
+
+    if (response.contains("result") && response["result"].contains("access_token")) {
+        const json& result = response["result"];
+        sessionRefreshToken_ = result.value("refresh_token", "");
+        wsAuthenticated_ = true;
+        int expiresIn = result.value("expires_in", 0);
+        LOG_INFO("[AUTH] WebSocket session authenticated ({}), expires in {} s",
+                 usedRefresh ? "refresh_token" : "client_credentials", expiresIn);
+        int64_t disconnectedNs = disconnectedNs_.load();
+        if (subscribe && disconnectedNs != 0) {
+            reconnectAuthenticated_.record(monotonicNs() - disconnectedNs);
+        }
+        scheduleSessionRefresh(expiresIn);
+        if (subscribe) subscribeToOrderbooks(instruments_);
+        return;
+    }
+
+    std::string error = response.contains("error") ? response["error"].dump() : response.dump();
+    if (usedRefresh) {
+        // Refresh tokens can be revoked or expire with their session
+        LOG_WARN("[AUTH] WebSocket refresh grant rejected ({}), using client credentials", error);
+        sessionRefreshToken_.clear();
+        if (subscribe) {
+            authenticateDeribit();
+        } else {
+            sendRpc("public/auth", {{"grant_type", "client_credentials"}, {"client_id", clientId_},
+                                    {"client_secret", clientSecret_}},
+                    [this](const json& retry) { onDeribitAuth(retry, false, false); });
+        }
+        return;
     }
+    LOG_ERROR("[AUTH] WebSocket authentication failed: {}", error);
+    if (subscribe) subscribeToOrderbooks(instruments_);  // public channels still work
+}
+
+void WebSocketServer::scheduleSessionRefresh(int expiresInSeconds) {
+    if (expiresInSeconds <= 0) return;
+    if (!sessionRefreshTimer_) {
+        sessionRefreshTimer_ = std::make_unique<boost::asio::steady_timer>(feedService_);
+    }
+    // Same margin as TokenManager: renew at 80% of the lifetime
+    sessionRefreshTimer_->expires_from_now(std::chrono::seconds(expiresInSeconds * 4 / 5));
+    sessionRefreshTimer_->async_wait([this](const boost::system::error_code& ec) {
+        if (ec || stopping_ || !currentDeribitConn() || sessionRefreshToken_.empty()) return;
+        sendRpc("public/auth", {{"grant_type", "refresh_token"}, {"refresh_token", sessionRefreshToken_}},
+                [this](const json& response) { onDeribitAuth(response, true, false); });
+    });
+}
+
+bool WebSocketServer::isDeribitAuthenticated() const {
+    return wsAuthenticated_.load();
+}
+
+std::shared_ptr<void> WebSocketServer::currentDeribitConn() const {
+    std::lock_guard<std::mutex> lock(connMutex_);
+    return deribitConn_.lock();
+}
+
+void WebSocketServer::setDeribitConn(websocketpp::connection_hdl hdl) {
+    std::lock_guard<std::mutex> lock(connMutex_);
+    deribitConn_ = hdl;
+}
+
+bool WebSocketServer::isDeribitConnected() const {
+    return currentDeribitConn() != nullptr;
+}
+
+void WebSocketServer::setTokenManager(TokenManager* tokens) {
+    tokens_ = tokens;
+}
+
+void WebSocketServer::sendRpc(const std::string& method, json params, RpcCallback callback) {
+    auto conn = currentDeribitConn();
+    if (!conn) {
+        callback(RpcTracker::makeError("No active connection to Deribit"));
+        return;
+    }
+
+    if (tokens_ && method.compare(0, 8, "private/") == 0) {
+        auto token = tokens_->current();
+        if (!token->empty()) {
+            params["access_token"] = *token;
+        }
+    }
+
+    LatencyHistogram& roundTrip = roundTripFor(method);
+    auto sent = std::chrono::steady_clock::now();
+    TokenManager* tokens = tokens_;
+    uint64_t id = rpc_.track([callback = std::move(callback), &roundTrip, sent, tokens](const json& response) {
+        roundTrip.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - sent).count());
+        // 13009 "unauthorized": the token was revoked early, renew it now
+        if (tokens && response.contains("error") && response["error"].value("code", 0) == 13009) {
+            tokens->refreshNow();
+        }
+        callback(response);
+    });
+    json request = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", method},
+        {"params", std::move(params)}
+    };
+
+    websocketpp::lib::error_code ec;
+    deribitClient_.send(conn, request.dump(), websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        std::cerr << "[ERROR] Failed to send " << method << ": " << ec.message() << std::endl;
+        rpc_.fail(id, ec.message());
+    }
+}
+
+std::future<json> WebSocketServer::sendRpc(const std::string& method, json params) {
+    auto promise = std::make_shared<std::promise<json>>();
+    std::future<json> future = promise->get_future();
+    sendRpc(method, std::move(params), [promise](const json& response) {
+        promise->set_value(response);
+    });
+    return future;
+}
+
+json WebSocketServer::orderParams(const std::string& instrument, double amount, double price, const std::string& orderType) {
+    json params = {
+        {"instrument_name", instrument},
+        {"amount", amount},
+        {"type", orderType}
+    };
+    if (orderType == "limit") {
+        params["price"] = price;
+    }
+    return params;
+}
+
+std::future<json> WebSocketServer::placeBuyOrder(const std::string& instrument, double amount, double price, const std::string& orderType) {
+    return sendRpc("private/buy", orderParams(instrument, amount, price, orderType));
+}
+
+std::future<json> WebSocketServer::placeSellOrder(const std::string& instrument, double amount, double price, const std::string& orderType) {
+    return sendRpc("private/sell", orderParams(instrument, amount, price, orderType));
+}
+
+std::future<json> WebSocketServer::modifyOrder(const std::string& orderId, double newAmount, double newPrice) {
+    return sendRpc("private/edit", {
+        {"order_id", orderId},
+        {"amount", newAmount},
+        {"price", newPrice}
+    });
+}
+
+std::future<json> WebSocketServer::cancelOrder(const std::string& orderId) {
+    return sendRpc("private/cancel", {{"order_id", orderId}});
 }
 
 void WebSocketServer::startHeartbeat() {
@@ -171,7 +653,7 @@ void WebSocketServer::scheduleNextHeartbeat() {
 }
 
 void WebSocketServer::sendHeartbeat() {
-    auto conn = deribitConn_.lock();
+    auto conn = currentDeribitConn();
     if (!conn) {
         std::cerr << "[ERROR] No active connection for heartbeat" << std::endl;
         return;
@@ -216,9 +698,23 @@ void WebSocketServer::stopHeartbeat() {
     }
 }
 
+void WebSocketServer::setInstruments(const std::vector<std::string>& instruments) {
+    instruments_ = instruments;
+    books_.reserve(instruments_.size());
+}
+
+void WebSocketServer::setFeedChannels(const std::string& interval, bool trades) {
+    feedInterval_ = interval;
+    feedTrades_ = trades;
+}
+
 void WebSocketServer::subscribeToOrderbook(const std::string& symbol) {
+    subscribeToOrderbooks({symbol});
+}
+
+void WebSocketServer::subscribeToOrderbooks(const std::vector<std::string>& symbols) {
     try {
-        auto conn = deribitConn_.lock();
+        auto conn = currentDeribitConn();
         if (!conn) {
             std::cerr << "[ERROR] No active connection to Deribit." << std::endl;
             return;
@@ -232,50 +728,259 @@ void WebSocketServer::subscribeToOrderbook(const std::string& symbol) {
             return;
         }
 
-        json message_json = {
-            {"jsonrpc", "2.0"},
-            {"id", 42},
-            {"method", "public/subscribe"},
-            {"params", {
-                {"channels", {std::string("book.") + symbol + ".100ms"}}
-            }}
-        };
+        std::string interval = feedInterval_;
+        if (interval == "raw" && !wsAuthenticated_ && !tokens_) {
+            std::cerr << "[ERROR] Raw channels need authentication, subscribing to 100ms instead" << std::endl;
+            interval = "100ms";
+        }
+        const char* method = interval == "raw" ? "private/subscribe" : "public/subscribe";
 
-        std::string message = message_json.dump();
-        
-        std::cout << " Sending Subscription Message: " << message << std::endl;
+        std::vector<std::string> names;
+        for (const auto& symbol : symbols) {
+            names.push_back("book." + symbol + "." + interval);
+            if (feedTrades_) names.push_back("trades." + symbol + "." + interval);
+        }
 
-        websocketpp::lib::error_code ec;
-        deribitClient_.send(conn, message, websocketpp::frame::opcode::text, ec);
+        // Many channels per request instead of one round trip per instrument
+        auto batches = std::make_shared<std::atomic<size_t>>((names.size() + kSubscribeBatch - 1) / kSubscribeBatch);
+        auto failed = std::make_shared<std::atomic<bool>>(false);
+        for (size_t first = 0; first < names.size(); first += kSubscribeBatch) {
+            size_t last = std::min(names.size(), first + kSubscribeBatch);
+            json channels = json::array();
+            for (size_t i = first; i < last; ++i) {
+                channels.push_back(names[i]);
+            }
 
-        if (ec) {
-            std::cerr << "[ERROR] Failed to subscribe to orderbook: " << ec.message() << std::endl;
-        } else {
-            std::cout << "[MSG] Subscription request sent for: " << symbol << std::endl;
+            size_t requested = channels.size();
+            sendRpc(method, {{"channels", std::move(channels)}}, [this, requested, batches, failed](const json& response) {
+                if (!response.contains("result")) {
+                    failed->store(true);
+                    std::cerr << "[ERROR] Subscription failed: " << response.value("error", json()).dump() << std::endl;
+                } else {
+                    std::cout << "[MSG] Subscription confirmed for " << response["result"].size()
+                              << " of " << requested << " channels" << std::endl;
+                }
+                if (batches->fetch_sub(1) != 1 || failed->load()) return;
+                // Every batch confirmed: the session is fully back after a drop.
+                // A failed round leaves disconnectedNs_ for the next attempt.
+                int64_t disconnectedNs = disconnectedNs_.exchange(0);
+                if (disconnectedNs != 0) {
+                    int64_t ns = monotonicNs() - disconnectedNs;
+                    reconnectResubscribed_.record(ns);
+                    LOG_INFO("[MSG] Reconnected, authenticated and resubscribed {} ms after the drop", ns / 1000000);
+                }
+            });
         }
+        std::cout << "[MSG] Subscription requests sent for " << symbols.size() << " instruments ("
+                  << interval << (feedTrades_ ? ", with trades" : "") << ")" << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "[ERROR] Exception in subscribeToOrderbook: " << e.what() << std::endl;
     }
 }
 
 void WebSocketServer::handleDeribitMessage(websocketpp::connection_hdl, WebsocketClientType::message_ptr msg) {
-    std::string payload = msg->get_payload();
-    
+    // Receive thread: stamp and hand off, decoding happens on the feed thread.
+    int64_t receivedNs = monotonicNs();
+    int64_t receivedWallNs = wallClockNs();
+    if (capture_.isOpen()) {
+        capture_.append(receivedWallNs, msg->get_payload());
+    }
+    // Only notifications may be dropped: BookSync repairs the gap. Responses
+    // resolve RpcTracker entries (orders, subscribe, auth) and are never lost.
+    bool wait = !isSubscriptionNotification(msg->get_payload());
+    enqueueFrame(std::move(msg), receivedNs, receivedWallNs, wait);
+}
+
+bool WebSocketServer::enqueueFrame(WebsocketClientType::message_ptr msg, int64_t receivedNs,
+                                   int64_t receivedWallNs, bool wait) {
+    RawFrame frame{std::move(msg), receivedNs, receivedWallNs};
+    while (!feedQueue_.tryPush(std::move(frame))) {
+        if (!wait || stopping_) {
+            feedDropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    size_t depth = feedQueue_.size();
+    if (depth > maxQueueDepth_.load(std::memory_order_relaxed)) {
+        maxQueueDepth_.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool WebSocketServer::startCapture(const std::string& path) {
+    if (!capture_.open(path)) return false;
+    std::cout << "[CAPTURE] Recording Deribit feed to " << path << std::endl;
+    return true;
+}
+
+int64_t WebSocketServer::replayCapture(const std::string& path, double speed) {
+    FeedCaptureReader reader;
+    if (!reader.open(path)) return -1;
+
+    uint64_t processedBefore = feedFrames_.load();
+    int64_t fed = 0;
+    int64_t firstCapturedNs = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    FeedCaptureReader::Frame frame;
+    while (!stopping_ && reader.next(frame)) {
+        if (speed > 0) {
+            if (fed == 0) firstCapturedNs = frame.receivedWallNs;
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(
+                static_cast<int64_t>((frame.receivedWallNs - firstCapturedNs) / speed)));
+        }
+
+        // Keep the recorded wall time so exchange_to_receive matches the session
+        if (enqueueFrame(makeFeedMessage(frame.payload.data(), frame.payload.size()), monotonicNs(),
+                         frame.receivedWallNs, true)) {
+            ++fed;
+        }
+    }
+
+    while (!stopping_ && feedFrames_.load() < processedBefore + fed) {
+        std::this_thread::yield();
+    }
+    return fed;
+}
+
+bool WebSocketServer::injectFrame(const std::string& payload) {
+    return enqueueFrame(makeFeedMessage(payload.data(), payload.size()), monotonicNs(), wallClockNs(), true);
+}
+
+void WebSocketServer::runReplay(uint16_t port, const std::string& path, double speed,
+                                unsigned threads, bool pinThreads) {
+    try {
+        listen(port);
+        std::cout << "WebSocket Server Running on Port " << port << ", replaying " << path << std::endl;
+
+        replayThread_ = std::thread([this, path, speed]() {
+            int64_t fed = replayCapture(path, speed);
+            if (fed >= 0) {
+                std::cout << "[REPLAY] Finished " << path << ": " << fed << " frames" << std::endl;
+            }
+        });
+
+        runServerThreads(threads, pinThreads);
+    } catch (const std::exception& e) {
+        std::cerr << "Error starting WebSocket Server: " << e.what() << std::endl;
+    }
+}
+
+void WebSocketServer::runFeedLoop() {
+    RawFrame frame;
+    unsigned idle = 0;
+    auto nextStatsLog = std::chrono::steady_clock::now() + kFeedStatsInterval;
+
+    while (feedRunning_) {
+        bool worked = false;
+        while (feedQueue_.tryPop(frame)) {
+            int64_t dequeuedNs = monotonicNs();
+            handoffLatency_.record(dequeuedNs - frame.receivedNs);
+
+            try {
+                dispatchFeedMessage(frame.msg->get_payload(), frame.receivedNs, frame.receivedWallNs);
+            } catch (const std::exception& e) {
+                LOG_ERROR("[ERROR] Exception in feed thread: {}", e.what());
+            }
+            frame.msg.reset();
+            dispatchLatency_.record(monotonicNs() - dequeuedNs);
+            // Counted once processed; replayCapture() waits on this
+            feedFrames_.fetch_add(1, std::memory_order_release);
+            worked = true;
+        }
+
+        try {
+            if (feedService_.poll() > 0) {
+                worked = true;
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("[ERROR] Exception in feed thread: {}", e.what());
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextStatsLog) {
+            nextStatsLog = now + kFeedStatsInterval;
+            FeedStats stats = feedStats();
+            if (stats.frames > 0) {
+                LOG_INFO("[FEED] frames {}, dropped {}, queue depth {} (max {}), handoff avg {} us, p99 {} us, max {} us",
+                         stats.frames, stats.dropped, stats.queueDepth, stats.maxQueueDepth,
+                         stats.avgHandoffUs, stats.p99HandoffUs, stats.maxHandoffUs);
+            }
+        }
+
+        if (worked) {
+            idle = 0;
+        } else if (++idle < kFeedSpinIterations) {
+            continue;
+        } else if (idle < kFeedYieldIterations) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+WebSocketServer::FeedStats WebSocketServer::feedStats() const {
+    FeedStats stats;
+    stats.frames = feedFrames_.load(std::memory_order_relaxed);
+    stats.dropped = feedDropped_.load(std::memory_order_relaxed);
+    stats.queueDepth = feedQueue_.size();
+    stats.maxQueueDepth = maxQueueDepth_.load(std::memory_order_relaxed);
+    stats.avgHandoffUs = handoffLatency_.mean() / 1e3;
+    stats.p99HandoffUs = handoffLatency_.percentile(99) / 1e3;
+    stats.maxHandoffUs = handoffLatency_.max() / 1e3;
+    return stats;
+}
+
+void WebSocketServer::dispatchFeedMessage(const std::string& payload) {
+    dispatchFeedMessage(payload, monotonicNs(), wallClockNs());
+}
 
+void WebSocketServer::dispatchFeedMessage(const std::string& payload, int64_t receivedNs, int64_t receivedWallNs) {
+    trace_.receivedNs = receivedNs;
+    trace_.receivedWallNs = receivedWallNs;
+    switch (feedDecoder_.decode(payload, channel_, bookUpdate_)) {
+    case FeedDecoder::Kind::Book:
+        trace_.parsedNs = monotonicNs();
+        tick_.parse.record(trace_.parsedNs - receivedNs);
+        if (bookUpdate_.timestamp > 0) {
+            tick_.exchange.record(receivedWallNs - bookUpdate_.timestamp * 1000000);
+        }
+        handleBookUpdate(channel_, payload);
+        return;
+    case FeedDecoder::Kind::Trades:
+        handleTrades(channel_, payload);
+        return;
+    case FeedDecoder::Kind::Other:
+        LOG_DEBUG("[RECEIVED] Received update for channel: {}", channel_);
+        return;
+    case FeedDecoder::Kind::Invalid:
+        LOG_ERROR("[ERROR] Malformed subscription message: {}", payload);
+        return;
+    case FeedDecoder::Kind::Control:
+        handleControlMessage(payload);
+        return;
+    }
+}
+
+void WebSocketServer::handleControlMessage(const std::string& payload) {
     try {
         json parsed_json = json::parse(payload);
+
+        if (parsed_json.contains("id") && parsed_json["id"].is_number_unsigned() &&
+            rpc_.resolve(parsed_json["id"].get<uint64_t>(), parsed_json)) {
+            return;
+        }
         
         if (parsed_json.contains("id") && parsed_json.contains("result")) {
-            std::cout << "[MSG] Received response for request ID " << parsed_json["id"] << std::endl;
+            LOG_INFO("[MSG] Received response for request ID {}", parsed_json["id"].dump());
              
             if (parsed_json["id"] == 9999) {
-                std::cout << "[HB] Heartbeat acknowledged by server" << std::endl;
+                LOG_DEBUG("[HB] Heartbeat acknowledged by server");
                 return;
             }
-            
-            if (parsed_json["id"] == 42) {
-                std::cout << "[MSG] Subscription confirmed: " << parsed_json["result"].dump(2) << std::endl;
-            }
         }
         
         if (parsed_json.contains("error")) {
@@ -283,42 +988,408 @@ void WebSocketServer::handleDeribitMessage(websocketpp::connection_hdl, Websocke
                       << parsed_json["error"]["code"] << ")" << std::endl;
             return;
         }
-        
-        if (parsed_json.contains("method") && parsed_json["method"] == "subscription") {
-            if (parsed_json.contains("params") && parsed_json["params"].contains("channel")) {
-                std::string channel = parsed_json["params"]["channel"];
-                
-        
-                if (channel.find("book.") == 0) {
-                    std::cout << "[WEBSOCKET] Received orderbook update for channel: " << channel << std::endl;
-                    
-        
-                    json data = parsed_json["params"]["data"];
-                    std::cout << "[WEBSOCKET] Book state: " << (data.contains("type") ? data["type"].get<std::string>() : "unknown") << std::endl;
-                    
-                    if (data.contains("bids") && data.contains("asks")) {
-                        std::cout << "   Top bid: " << (data["bids"].size() > 0 ? data["bids"][0].dump() : "none") << std::endl;
-                        std::cout << "   Top ask: " << (data["asks"].size() > 0 ? data["asks"][0].dump() : "none") << std::endl;
-                    }
-                    
-        
-                    for (const auto& client : clients_) {
-                        websocketpp::lib::error_code ec;
-                        wsServer_.send(client, payload, websocketpp::frame::opcode::text, ec);
-                        
-                        if (ec) {
-                            std::cerr << "[ERROR] Error sending to client: " << ec.message() << std::endl;
-                        }
-                    }
-                } else {
-                    std::cout << "[RECEIVED] Received update for channel: " << channel << std::endl;
-                }
-            }
-        }
     } catch (const json::exception& e) {
         std::cerr << "[ERROR] Failed to parse JSON: " << e.what() << std::endl;
         std::cerr << "   Raw payload: " << payload << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "[ERROR] Exception processing message: " << e.what() << std::endl;
     }
+}
+
+void WebSocketServer::handleBookUpdate(const std::string& channel, const std::string& payload) {
+    LOG_DEBUG("[WEBSOCKET] Received orderbook update for channel: {}", channel);
+
+    BookSync& sync = bookSyncFor(channel, bookUpdate_.instrument);
+    if (!sync.onUpdate(bookUpdate_)) {
+        // Gap or stale delta: hold it back until the book is consistent again
+        return;
+    }
+    trace_.appliedNs = monotonicNs();
+    tick_.apply.record(trace_.appliedNs - trace_.parsedNs);
+
+    const OrderBook& book = sync.book();
+    LOG_DEBUG("[WEBSOCKET] Book state: {} (change_id {})", bookUpdate_.snapshot ? "snapshot" : "change", book.changeId());
+    const PriceLevel* bid = book.bestBid();
+    const PriceLevel* ask = book.bestAsk();
+    if (bid) LOG_DEBUG("   Top bid: {} x {}", bid->price, bid->amount);
+    else LOG_DEBUG("   Top bid: none");
+    if (ask) LOG_DEBUG("   Top ask: {} x {}", ask->price, ask->amount);
+    else LOG_DEBUG("   Top ask: none");
+
+    broadcast(channel, payload, &trace_);
+}
+
+void WebSocketServer::handleTrades(const std::string& channel, const std::string& payload) {
+    int64_t receivedWallNs = trace_.receivedWallNs;
+    for (const auto& trade : feedDecoder_.trades()) {
+        LOG_DEBUG("[TRADE] {} {} {} @ {}", trade.instrument.view(), toString(trade.direction), trade.amount, trade.price);
+        if (trade.timestamp > 0) {
+            tick_.trade.record(receivedWallNs - trade.timestamp * 1000000);
+        }
+    }
+    // Trades do not touch the books; pass them on as received.
+    broadcast(channel, payload);
+}
+
+WebsocketServerType::message_ptr WebSocketServer::prepareFrame(const std::string& payload,
+                                                               websocketpp::frame::opcode::value opcode) {
+    // No connection message manager: the buffer is shared, never recycled.
+    auto frame = std::make_shared<WebsocketServerType::message_type>(
+        WebsocketServerType::message_type::con_msg_man_ptr(), opcode, payload.size());
+
+    websocketpp::frame::basic_header header(opcode, payload.size(), true, false);
+    websocketpp::frame::extended_header extended(payload.size());
+    frame->set_header(websocketpp::frame::prepare_header(header, extended));
+    frame->set_payload(payload);
+    frame->set_prepared(true);
+    return frame;
+}
+
+void WebSocketServer::broadcast(const std::string& channel, const std::string& payload, const TickTrace* trace) {
+    SubscriptionIndex::SubscriberList subscribers = subscriptions_.subscribers(channel);
+    if (!subscribers) return;
+
+    // Frame once here, then every connection queues the same immutable
+    // buffer from the server's own strand(s).
+    WebsocketServerType::message_ptr frame = prepareFrame(payload);
+    int64_t receivedNs = 0, serializedNs = 0;
+    if (trace) {
+        receivedNs = trace->receivedNs;
+        serializedNs = monotonicNs();
+        tick_.serialize.record(serializedNs - trace->appliedNs);
+    }
+
+    if (serverThreads_.load(std::memory_order_relaxed) > 1) {
+        // One handler per client on its strand; the last one to finish
+        // closes the tick trace.
+        struct Fanout {
+            std::string channel;
+            std::atomic<size_t> remaining;
+        };
+        auto fanout = std::make_shared<Fanout>();
+        fanout->channel = channel;
+        fanout->remaining = subscribers->size();
+        for (const auto& client : *subscribers) {
+            client->strand.post([this, client, frame, fanout, receivedNs, serializedNs]() {
+                deliver(client, fanout->channel, frame);
+                if (fanout->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && receivedNs) {
+                    int64_t sentNs = monotonicNs();
+                    tick_.send.record(sentNs - serializedNs);
+                    tick_.total.record(sentNs - receivedNs);
+                }
+            });
+        }
+        return;
+    }
+
+    serverStrand_->post([this, channel, subscribers, frame, receivedNs, serializedNs]() {
+        for (const auto& client : *subscribers) {
+            deliver(client, channel, frame);
+        }
+
+        if (receivedNs) {
+            int64_t sentNs = monotonicNs();
+            tick_.send.record(sentNs - serializedNs);
+            tick_.total.record(sentNs - receivedNs);
+        }
+    });
+}
+
+void WebSocketServer::deliver(const ClientPtr& client, const std::string& channel,
+                              const WebsocketServerType::message_ptr& frame) {
+    websocketpp::lib::error_code ec;
+    WebsocketServerType::connection_ptr con = wsServer_.get_con_from_hdl(client->hdl, ec);
+    if (ec || client->closing) return;
+
+    size_t buffered = con->get_buffered_amount();
+    client->noteBuffered(buffered);
+    // Only a book can be replaced by a snapshot; trades are queued instead
+    bool book = channel.compare(0, 5, "book.") == 0;
+    if (book && client->conflating.load(std::memory_order_relaxed)) {
+        // Bounded by construction, so the slow-consumer policy does not apply
+        markStale(client, channel, buffered == 0);
+        return;
+    }
+
+    BackpressurePolicy::Mode mode = backpressure_.mode;
+    if (mode == BackpressurePolicy::Mode::Conflate && !book) mode = BackpressurePolicy::Mode::DropOldest;
+
+    bool over = buffered >= backpressure_.maxBufferedBytes;
+    if (over && !client->backlogged.load(std::memory_order_relaxed)) {
+        LOG_WARN("[SLOW] Client {} ({}) has {} bytes buffered, {}", client->id, client->remote, buffered,
+                 toString(mode));
+    }
+
+    switch (mode) {
+    case BackpressurePolicy::Mode::Disconnect:
+        if (over) {
+            disconnectSlowClient(*client, *con, buffered);
+            return;
+        }
+        break;
+    case BackpressurePolicy::Mode::Conflate: {
+        if (!over && client->staleChannels.count(channel) == 0) break;
+        // Skip the delta; one snapshot replaces everything skipped once the
+        // client has drained.
+        markStale(client, channel, buffered <= backpressure_.maxBufferedBytes / 2);
+        return;
+    }
+    case BackpressurePolicy::Mode::DropOldest:
+        if (!over && client->pending.empty()) break;
+        client->pending.push_back(frame);
+        while (client->pending.size() > backpressure_.maxPendingFrames) {
+            client->pending.pop_front();
+            client->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        client->backlogged = true;
+        flushPending(*client, *con);
+        return;
+    }
+
+    ec = con->send(frame);
+    if (ec) {
+        LOG_ERROR("[ERROR] Error sending to client: {}", ec.message());
+    }
+}
+
+void WebSocketServer::markStale(const ClientPtr& client, const std::string& channel, bool canFlush) {
+    client->conflated.fetch_add(1, std::memory_order_relaxed);
+    auto stale = client->staleChannels.find(channel);
+    if (stale == client->staleChannels.end()) {
+        stale = client->staleChannels.emplace(channel, false).first;
+        client->backlogged = true;
+    }
+    if (!stale->second && canFlush) {
+        stale->second = true;
+        requestClientSnapshot(client, channel);
+    }
+}
+
+void WebSocketServer::flushPending(ClientSession& client, WebsocketServerType::connection_type& con) {
+    while (!client.pending.empty() && con.get_buffered_amount() < backpressure_.maxBufferedBytes) {
+        websocketpp::lib::error_code ec = con.send(client.pending.front());
+        client.pending.pop_front();
+        if (ec) {
+            LOG_ERROR("[ERROR] Error sending to client: {}", ec.message());
+        }
+    }
+    client.pendingFrames.store(client.pending.size(), std::memory_order_relaxed);
+}
+
+void WebSocketServer::flushClient(const ClientPtr& client) {
+    websocketpp::lib::error_code ec;
+    WebsocketServerType::connection_ptr con = wsServer_.get_con_from_hdl(client->hdl, ec);
+    if (ec || client->closing) {
+        client->backlogged = false;
+        return;
+    }
+
+    size_t buffered = con->get_buffered_amount();
+    client->noteBuffered(buffered);
+    if (backpressure_.mode == BackpressurePolicy::Mode::Disconnect &&
+        buffered >= backpressure_.maxBufferedBytes) {
+        disconnectSlowClient(*client, *con, buffered);
+        return;
+    }
+
+    flushPending(*client, *con);
+    size_t drained = client->conflating.load(std::memory_order_relaxed) ? 0 : backpressure_.maxBufferedBytes / 2;
+    if (buffered <= drained) {
+        for (auto& stale : client->staleChannels) {
+            if (stale.second) continue;
+            stale.second = true;
+            requestClientSnapshot(client, stale.first);
+        }
+    }
+    client->backlogged = !client->pending.empty() || !client->staleChannels.empty();
+}
+
+void WebSocketServer::disconnectSlowClient(ClientSession& client, WebsocketServerType::connection_type& con,
+                                           size_t buffered) {
+    client.closing = true;
+    client.backlogged = false;
+    slowDisconnects_.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN("[SLOW] Disconnecting client {} ({}) with {} bytes buffered", client.id, client.remote, buffered);
+
+    websocketpp::lib::error_code ec;
+    con.close(websocketpp::close::status::try_again_later, "slow consumer", ec);
+    if (ec) {
+        LOG_ERROR("[ERROR] Error closing slow client: {}", ec.message());
+    }
+}
+
+void WebSocketServer::requestClientSnapshot(const ClientPtr& client, const std::string& channel) {
+    feedService_.post([this, client, channel]() {
+        // Deltas already queued for the client predate this snapshot and are
+        // still skipped; the ones the feed thread posts after it are sent.
+        WebsocketServerType::message_ptr frame;
+        auto it = books_.find(channel);
+        if (it != books_.end() && it->second.live() && subscriptions_.isSubscribed(client->hdl, channel)) {
+            frame = snapshotFrame(channel, it->second.book());
+        }
+        strandFor(client).post([this, client, channel, frame]() {
+            client->staleChannels.erase(channel);
+            client->backlogged = !client->pending.empty() || !client->staleChannels.empty();
+            if (!frame) return;
+            websocketpp::lib::error_code ec;
+            wsServer_.send(client->hdl, frame, ec);
+            if (ec) {
+                LOG_ERROR("[ERROR] Error sending to client: {}", ec.message());
+            }
+        });
+    });
+}
+
+WebsocketServerType::message_ptr WebSocketServer::snapshotFrame(const std::string& channel, const OrderBook& book) {
+    SnapshotFrame& cached = snapshotFrames_[channel];
+    if (!cached.frame || cached.changeId != book.changeId()) {
+        cached.changeId = book.changeId();
+        cached.frame = prepareFrame(bookSnapshotMessage(channel, book).dump());
+    }
+    return cached.frame;
+}
+
+void WebSocketServer::scheduleBackpressureCheck() {
+    backpressureTimer_->expires_from_now(kBackpressureInterval);
+    backpressureTimer_->async_wait([this](const boost::system::error_code& ec) {
+        if (ec) return;
+        checkBackpressure();
+        scheduleBackpressureCheck();
+    });
+}
+
+void WebSocketServer::checkBackpressure() {
+    std::vector<ClientPtr> backlogged;
+    size_t clients = 0, totalBuffered = 0, maxBuffered = 0;
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        clients = clients_.size();
+        for (const auto& entry : clients_) {
+            const ClientPtr& client = entry.second;
+            size_t buffered = client->bufferedBytes.load(std::memory_order_relaxed);
+            totalBuffered += buffered;
+            maxBuffered = std::max(maxBuffered, buffered);
+            if (client->backlogged.load(std::memory_order_relaxed)) backlogged.push_back(client);
+        }
+    }
+
+    for (const auto& client : backlogged) {
+        strandFor(client).post([this, client]() { flushClient(client); });
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= nextClientsLog_) {
+        nextClientsLog_ = now + kClientStatsInterval;
+        if (clients > 0) {
+            LOG_INFO("[CLIENTS] {} clients, {} bytes buffered (max {} on one), {} backlogged, {} disconnected as slow",
+                     clients, totalBuffered, maxBuffered, backlogged.size(), slowDisconnects());
+        }
+    }
+}
+
+void WebSocketServer::setBackpressurePolicy(const BackpressurePolicy& policy) {
+    backpressure_ = policy;
+}
+
+std::vector<WebSocketServer::ClientStats> WebSocketServer::clientStats() const {
+    std::vector<ClientStats> stats;
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    stats.reserve(clients_.size());
+    for (const auto& entry : clients_) {
+        const ClientSession& client = *entry.second;
+        ClientStats s;
+        s.id = client.id;
+        s.remote = client.remote;
+        s.bufferedBytes = client.bufferedBytes.load(std::memory_order_relaxed);
+        s.maxBufferedBytes = client.maxBufferedBytes.load(std::memory_order_relaxed);
+        s.pendingFrames = client.pendingFrames.load(std::memory_order_relaxed);
+        s.dropped = client.dropped.load(std::memory_order_relaxed);
+        s.conflated = client.conflated.load(std::memory_order_relaxed);
+        stats.push_back(std::move(s));
+    }
+    return stats;
+}
+
+json WebSocketServer::clientReport() const {
+    json clients = json::array();
+    for (const auto& s : clientStats()) {
+        clients.push_back({{"id", s.id}, {"remote", s.remote}, {"buffered_bytes", s.bufferedBytes},
+                           {"max_buffered_bytes", s.maxBufferedBytes}, {"pending_frames", s.pendingFrames},
+                           {"dropped", s.dropped}, {"conflated", s.conflated}});
+    }
+    return {{"policy", toString(backpressure_.mode)}, {"max_buffered_bytes", backpressure_.maxBufferedBytes},
+            {"slow_disconnects", slowDisconnects()}, {"clients", std::move(clients)}};
+}
+
+json WebSocketServer::latencyReport(const std::string& prefix) const {
+    json report = json::object();
+    LatencyRegistry::instance().forEach([&](const std::string& name, const LatencyHistogram& histogram) {
+        if (name.compare(0, prefix.size(), prefix) == 0) report[name] = histogramSummary(histogram);
+    });
+    return report;
+}
+
+BookSync& WebSocketServer::bookSyncFor(const std::string& channel, const std::string& instrument) {
+    auto it = books_.find(channel);
+    if (it == books_.end()) {
+        it = books_.emplace(channel, BookSync(channel, instrument, [this, channel](const std::string& name) {
+            requestBookSnapshot(channel, name);
+        })).first;
+    }
+    return it->second;
+}
+
+void WebSocketServer::requestBookSnapshot(const std::string& channel, const std::string& instrument, unsigned retry) {
+    if (retry == 0) LOG_WARN("[GAP] Sequence gap on {}, fetching snapshot", channel);
+
+    restService_.post([this, channel, instrument, retry]() {
+        json response;
+        for (int attempt = 0; attempt < kResyncAttempts && !stopping_; ++attempt) {
+            response = getMarketData("", "", instrument, kResyncDepth);
+            if (response.contains("orderbook") && response["orderbook"].contains("result")) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        feedService_.post([this, channel, response, retry]() {
+            onBookSnapshot(channel, response, retry);
+        });
+    });
+}
+
+void WebSocketServer::scheduleSnapshotRetry(const std::string& channel, const std::string& instrument, unsigned retry) {
+    auto delay = std::min(kResyncRetryMinDelay * (1 << std::min(retry, 5u)), kResyncRetryMaxDelay);
+    LOG_ERROR("[ERROR] Could not fetch snapshot for {}, retrying in {} ms", channel, delay.count());
+
+    // Waits on restService_ so the feed thread never sleeps
+    auto timer = std::make_shared<boost::asio::steady_timer>(restService_, delay);
+    timer->async_wait([this, timer, channel, instrument, retry](const boost::system::error_code& ec) {
+        if (ec || stopping_) return;
+        feedService_.post([this, channel, instrument, retry]() {
+            auto it = books_.find(channel);
+            if (it == books_.end() || it->second.live()) return;
+            requestBookSnapshot(channel, instrument, retry + 1);
+        });
+    });
+}
+
+void WebSocketServer::onBookSnapshot(const std::string& channel, const json& response, unsigned retry) {
+    auto it = books_.find(channel);
+    if (it == books_.end()) return;
+
+    BookUpdate snapshot;
+    if (!response.contains("orderbook") || !response["orderbook"].contains("result") ||
+        !parseOrderBookSnapshot(response["orderbook"]["result"], snapshot)) {
+        scheduleSnapshotRetry(channel, it->second.book().instrument(), retry);
+        return;
+    }
+
+    BookSync& sync = it->second;
+    if (sync.onSnapshot(snapshot)) {
+        LOG_BENCH("[GAP] {} resynced in {} ms", channel, sync.lastRecoveryMs());
+        latency("book resync").record(static_cast<int64_t>(sync.lastRecoveryMs() * 1e6));
+
+        // Downstream clients missed the held-back deltas; reset them with the full book.
+        if (subscriptions_.subscribers(channel)) {
+            broadcast(channel, bookSnapshotMessage(channel, sync.book()).dump());
+        }
+    }
 }
\ No newline at end of file
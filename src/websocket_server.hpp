@@ -2,10 +2,16 @@
 
 #include <iostream>
 #include <string>
+#include <map>
 #include <set>
+#include <unordered_map>
+#include <vector>
 #include <thread>
 #include <memory>
 #include <functional>
+#include <atomic>
+#include <future>
+#include <mutex>
 
 // WebSocket++ includes
 #include <websocketpp/config/asio_client.hpp>
@@ -15,8 +21,25 @@
 #include <websocketpp/common/thread.hpp>
 #include <websocketpp/common/memory.hpp>
 
-// Boost includes for timer
+// Boost includes for timer and the REST worker
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+
+#include "../json.hpp"
+#include "rpc_tracker.hpp"
+#include "deribit_config.hpp"
+#include "token_manager.hpp"
+#include "order_book.hpp"
+#include "book_sync.hpp"
+#include "feed_decoder.hpp"
+#include "client_session.hpp"
+#include "subscription_index.hpp"
+#include "spsc_queue.hpp"
+#include "latency_histogram.hpp"
+#include "feed_capture.hpp"
+
+using json = nlohmann::json;
 
 // WebSocket type definitions
 typedef websocketpp::client<websocketpp::config::asio_tls_client> WebsocketClientType;
@@ -24,22 +47,195 @@ typedef websocketpp::server<websocketpp::config::asio> WebsocketServerType;
 
 class WebSocketServer {
 public:
-    WebSocketServer();
+    explicit WebSocketServer(const std::string& deribitUrl = DeribitConfig::instance().wsUrl);
     ~WebSocketServer();
 
-    void run(uint16_t port);
+    // Serves local clients and connects upstream; blocks until stop(). With
+    // threads > 1 the server io_service runs on that many threads, each
+    // client's sends going through its own strand; pinThreads binds thread i
+    // to core i (mod the core count).
+    void run(uint16_t port, unsigned threads = 1, bool pinThreads = false);
+    // Like run() without the Deribit connection: frames come from
+    // injectFrame() (benchmarks, tests against synthetic feeds).
+    void serve(uint16_t port, unsigned threads = 1, bool pinThreads = false);
     void stop();
 
+    bool isDeribitConnected() const;
+    // True once public/auth succeeded on the current Deribit connection
+    bool isDeribitAuthenticated() const;
+
+    // API key used to authenticate the Deribit socket itself (public/auth on
+    // every open, refreshed at 80% of its lifetime). Without it the session
+    // stays public. Call before run().
+    void setCredentials(const std::string& clientId, const std::string& clientSecret);
+
+    // Instruments whose books are subscribed once the Deribit socket opens.
+    void setInstruments(const std::vector<std::string>& instruments);
+    // Upstream channels per instrument: book.<instrument>.<interval>, plus
+    // trades.<instrument>.<interval> with `trades`. The interval is "100ms"
+    // (default, aggregated) or "raw" (every change, no batching delay). Raw
+    // channels need an authorized connection, so they are subscribed with
+    // private/subscribe and require a token manager. Call before run().
+    void setFeedChannels(const std::string& interval, bool trades);
+
+    // Entry point for every Deribit frame; also used for replay and benchmarks.
+    // Must be called from one thread at a time (normally the feed thread).
+    // The receive timestamps (steady and wall clock, ns) start the frame's
+    // tick-to-client trace; the short form uses "now".
+    void dispatchFeedMessage(const std::string& payload);
+    void dispatchFeedMessage(const std::string& payload, int64_t receivedNs, int64_t receivedWallNs);
+    // Queues one frame for the feed thread as if it had arrived from Deribit,
+    // waiting while the queue is full. Same single-producer rule as above.
+    bool injectFrame(const std::string& payload);
+
+    // Receive -> decode handoff counters
+    struct FeedStats {
+        uint64_t frames = 0;
+        uint64_t dropped = 0;       // queue full
+        size_t queueDepth = 0;
+        size_t maxQueueDepth = 0;
+        double avgHandoffUs = 0;
+        double p99HandoffUs = 0;
+        double maxHandoffUs = 0;
+    };
+    FeedStats feedStats() const;
+
+    // What to do with downstream clients that fall behind. Call before run().
+    void setBackpressurePolicy(const BackpressurePolicy& policy);
+
+    // Per-client outbound buffering; also served to clients as admin/clients
+    struct ClientStats {
+        uint64_t id = 0;
+        std::string remote;
+        size_t bufferedBytes = 0;
+        size_t maxBufferedBytes = 0;
+        size_t pendingFrames = 0;
+        uint64_t dropped = 0;
+        uint64_t conflated = 0;
+    };
+    std::vector<ClientStats> clientStats() const;
+    uint64_t slowDisconnects() const { return slowDisconnects_.load(std::memory_order_relaxed); }
+
+    // Appends every inbound Deribit frame to a capture file. Call before run().
+    bool startCapture(const std::string& path);
+
+    // Feeds a capture through the normal receive path from the calling thread,
+    // which takes the place of the Deribit connection (do not use both).
+    // speed 1 keeps the recorded pacing, N plays N times faster and 0 as fast
+    // as the feed thread keeps up. Returns once every frame has been
+    // processed, with the number of frames, or -1 if the file is unreadable.
+    int64_t replayCapture(const std::string& path, double speed);
+    // Serves local clients from a capture instead of a live Deribit connection.
+    void runReplay(uint16_t port, const std::string& path, double speed,
+                   unsigned threads = 1, bool pinThreads = false);
+
+    // Source of the token attached to private/* requests sent over the
+    // Deribit socket. Must outlive the server.
+    void setTokenManager(TokenManager* tokens);
+
+    // JSON-RPC over the open Deribit connection. The callback receives the
+    // full response (or a synthetic error if the request could not be sent)
+    // on the feed thread, so it must not block on another request.
+    using RpcCallback = std::function<void(const json& response)>;
+    void sendRpc(const std::string& method, json params, RpcCallback callback);
+    std::future<json> sendRpc(const std::string& method, json params);
+
+    // Order entry over the WebSocket: one frame per request on the open socket.
+    std::future<json> placeBuyOrder(const std::string& instrument, double amount, double price, const std::string& orderType);
+    std::future<json> placeSellOrder(const std::string& instrument, double amount, double price, const std::string& orderType);
+    std::future<json> modifyOrder(const std::string& orderId, double newAmount, double newPrice);
+    std::future<json> cancelOrder(const std::string& orderId);
+
+    // Builds a complete, already-framed server message. RFC 6455 server
+    // frames are unmasked, so one prepared message can be queued on every
+    // connection as-is instead of being re-framed and copied per client.
+    static WebsocketServerType::message_ptr prepareFrame(const std::string& payload,
+        websocketpp::frame::opcode::value opcode = websocketpp::frame::opcode::text);
+
 private:
     // Server event handlers
     void onOpen(websocketpp::connection_hdl hdl);
     void onClose(websocketpp::connection_hdl hdl);
     void onMessage(websocketpp::connection_hdl hdl, WebsocketServerType::message_ptr msg);
+    void updateSubscriptions(const ClientPtr& client, const json& id, bool subscribe,
+                             const std::vector<std::string>& channels);
+    void sendToClient(websocketpp::connection_hdl hdl, const std::string& payload);
+    // From the feed thread: queue a send on the strand that owns the client.
+    void postToClient(const ClientPtr& client, std::string payload);
+    // serverStrand_ with a single server thread, the client's own otherwise
+    boost::asio::io_service::strand& strandFor(const ClientPtr& client);
+    ClientPtr findClient(websocketpp::connection_hdl hdl);
+
+    // Slow-consumer handling, all on the client's strand. deliver() sends a
+    // channel update subject to backpressure_; flushClient() retries the
+    // held-back work of a backlogged client.
+    void deliver(const ClientPtr& client, const std::string& channel, const WebsocketServerType::message_ptr& frame);
+    void flushClient(const ClientPtr& client);
+    void flushPending(ClientSession& client, WebsocketServerType::connection_type& con);
+    void disconnectSlowClient(ClientSession& client, WebsocketServerType::connection_type& con, size_t buffered);
+    // Skips an update for the client, remembering the channel as stale; with
+    // `canFlush` the current book is requested right away.
+    void markStale(const ClientPtr& client, const std::string& channel, bool canFlush);
+    // Fetches the channel's current book on the feed thread, then sends it
+    // and lifts the client's conflation for that channel.
+    void requestClientSnapshot(const ClientPtr& client, const std::string& channel);
+    // Feed thread: the framed snapshot of the channel's book, serialized once
+    // per change_id however many clients ask for it.
+    WebsocketServerType::message_ptr snapshotFrame(const std::string& channel, const OrderBook& book);
+    void scheduleBackpressureCheck();
+    void checkBackpressure();
+    json clientReport() const;
+
+    void listen(uint16_t port);
+    // Runs wsServer_ on `threads` threads (the caller's included) until stop()
+    void runServerThreads(unsigned threads, bool pinThreads);
 
-    // Deribit connection and management
+    // Deribit connection and management. connectToDeribit() starts the
+    // client thread once; drops go through scheduleReconnect() and
+    // openDeribitConnection() on that thread.
     void connectToDeribit();
+    void openDeribitConnection();
+    void onDeribitDisconnected(const std::string& reason);
+    void scheduleReconnect();
+    // Feed thread: public/auth on the open connection, then subscriptions
+    void authenticateDeribit();
+    void onDeribitAuth(const json& response, bool usedRefresh, bool subscribe);
+    void scheduleSessionRefresh(int expiresInSeconds);
     void subscribeToOrderbook(const std::string& symbol);
+    void subscribeToOrderbooks(const std::vector<std::string>& symbols);
     void handleDeribitMessage(websocketpp::connection_hdl hdl, WebsocketClientType::message_ptr msg);
+    // Producer side of feedQueue_. When full, drops the frame or (with `wait`)
+    // spins until there is room. The receive thread waits for control frames
+    // and drops only subscription notifications.
+    bool enqueueFrame(WebsocketClientType::message_ptr msg, int64_t receivedNs, int64_t receivedWallNs, bool wait);
+    void handleControlMessage(const std::string& payload);
+    void handleBookUpdate(const std::string& channel, const std::string& payload);
+    void handleTrades(const std::string& channel, const std::string& payload);
+    std::shared_ptr<void> currentDeribitConn() const;
+    void setDeribitConn(websocketpp::connection_hdl hdl);
+    // Monotonic timestamps of one book update on its way through the process
+    struct TickTrace {
+        int64_t receivedNs = 0;
+        int64_t receivedWallNs = 0;
+        int64_t parsedNs = 0;
+        int64_t appliedNs = 0;
+    };
+    // Sends to the subscribers of `channel` only. With a trace, the serialize
+    // and send stages are recorded too.
+    void broadcast(const std::string& channel, const std::string& payload, const TickTrace* trace = nullptr);
+    // admin/latency: histogram percentiles, optionally filtered by name prefix
+    json latencyReport(const std::string& prefix) const;
+    void runFeedLoop();
+
+    // Book consistency: snapshots for gapped books are fetched over REST on
+    // restService_ and applied back on the feed thread. A failed fetch is
+    // retried after a backoff while the book is still waiting for one.
+    BookSync& bookSyncFor(const std::string& channel, const std::string& instrument);
+    void requestBookSnapshot(const std::string& channel, const std::string& instrument, unsigned retry = 0);
+    void onBookSnapshot(const std::string& channel, const json& response, unsigned retry);
+    void scheduleSnapshotRetry(const std::string& channel, const std::string& instrument, unsigned retry);
+
+    static json orderParams(const std::string& instrument, double amount, double price, const std::string& orderType);
     
     // Heartbeat management
     void startHeartbeat();
@@ -49,12 +245,104 @@ private:
 
     // WebSocket server instance
     WebsocketServerType wsServer_;
-    std::set<websocketpp::connection_hdl, std::owner_less<websocketpp::connection_hdl>> clients_;
+    // Open/close handlers run on any server thread
+    std::map<websocketpp::connection_hdl, ClientPtr, std::owner_less<websocketpp::connection_hdl>> clients_;
+    mutable std::mutex clientsMutex_;
+    std::atomic<uint64_t> nextClientId_{1};
+    BackpressurePolicy backpressure_;
+    std::atomic<uint64_t> slowDisconnects_{0};
+    // Periodic flush of backlogged clients and buffer stats, on wsServer_'s io_service
+    std::unique_ptr<boost::asio::steady_timer> backpressureTimer_;
+    std::chrono::steady_clock::time_point nextClientsLog_;
+    // Owned by the feed thread, like the books, so a new subscriber gets its
+    // snapshot before any later delta; server handlers post to it.
+    SubscriptionIndex subscriptions_;
+    // Every send to downstream clients runs on the server's own io_service:
+    // all on serverStrand_ with one server thread, on per-client strands with
+    // more, so broadcasts to different clients proceed in parallel.
+    std::unique_ptr<boost::asio::io_service::strand> serverStrand_;
+    std::atomic<unsigned> serverThreads_{1};
 
     // Deribit WebSocket client
+    std::string deribitUrl_;
+    std::vector<std::string> instruments_{"BTC-PERPETUAL"};
+    std::string feedInterval_ = "100ms";
+    bool feedTrades_ = false;
     WebsocketClientType deribitClient_;
     std::weak_ptr<void> deribitConn_;  // Using weak_ptr to handle connection lifetime
+    mutable std::mutex connMutex_;     // deribitConn_ is read from caller threads
     std::thread deribitThread_;
+    std::atomic<bool> stopping_{false};
+    std::shared_ptr<boost::asio::steady_timer> reconnectTimer_;
+    std::chrono::milliseconds reconnectDelay_{500};  // Deribit io thread only
+
+    // WebSocket session auth. The refresh token and timer are feed-thread only.
+    std::string clientId_;
+    std::string clientSecret_;
+    std::string sessionRefreshToken_;
+    std::atomic<bool> wsAuthenticated_{false};
+    // Steady-clock ns of the drop being recovered from, 0 when connected
+    std::atomic<int64_t> disconnectedNs_{0};
+    LatencyHistogram& reconnectOpen_ = latency("ws reconnect_to_open");
+    LatencyHistogram& reconnectAuthenticated_ = latency("ws reconnect_to_authenticated");
+    LatencyHistogram& reconnectResubscribed_ = latency("ws reconnect_to_resubscribed");
+
+    // In-flight JSON-RPC requests on the Deribit connection
+    RpcTracker rpc_;
+
+    // The Deribit io thread only timestamps and enqueues frames; feedThread_
+    // decodes them, keeps the books and runs work posted via feedService_.
+    struct RawFrame {
+        WebsocketClientType::message_ptr msg;
+        int64_t receivedNs = 0;
+        int64_t receivedWallNs = 0;
+    };
+    SpscQueue<RawFrame> feedQueue_{65536};
+    boost::asio::io_service feedService_;
+    std::unique_ptr<boost::asio::io_service::work> feedWork_;
+    std::unique_ptr<boost::asio::steady_timer> sessionRefreshTimer_;
+    std::thread feedThread_;
+    std::atomic<bool> feedRunning_{true};
+    std::atomic<uint64_t> feedFrames_{0};
+    std::atomic<uint64_t> feedDropped_{0};
+    LatencyHistogram& handoffLatency_ = latency("feed handoff");
+    LatencyHistogram& dispatchLatency_ = latency("feed dispatch");
+    std::atomic<size_t> maxQueueDepth_{0};
+
+    FeedCaptureWriter capture_;  // written on the Deribit io thread
+    std::thread replayThread_;
+
+    // Local L2 books keyed by channel, owned by the feed thread
+    std::unordered_map<std::string, BookSync> books_;
+    struct SnapshotFrame {
+        int64_t changeId = 0;
+        WebsocketServerType::message_ptr frame;
+    };
+    std::unordered_map<std::string, SnapshotFrame> snapshotFrames_;
+    FeedDecoder feedDecoder_;  // simdjson hot path for subscription notifications
+    std::string channel_;      // reused decode buffers
+    BookUpdate bookUpdate_;
+    TickTrace trace_;          // for the frame being dispatched
+
+    // Tick-to-client stages, from our socket read to the last wsServer_.send
+    // of the update. exchange_to_receive compares our wall clock against
+    // Deribit's "timestamp" (ms), so it includes any clock offset.
+    struct TickStages {
+        LatencyHistogram& exchange = latency("tick exchange_to_receive");
+        LatencyHistogram& parse = latency("tick receive_to_parse");
+        LatencyHistogram& apply = latency("tick parse_to_apply");
+        LatencyHistogram& serialize = latency("tick apply_to_serialize");
+        LatencyHistogram& send = latency("tick serialize_to_send");
+        LatencyHistogram& total = latency("tick receive_to_send");
+        LatencyHistogram& trade = latency("tick trade_exchange_to_receive");
+    };
+    TickStages tick_;
+
+    // Worker for blocking REST calls made on behalf of the feed
+    boost::asio::io_service restService_;
+    std::unique_ptr<boost::asio::io_service::work> restWork_;
+    std::thread restThread_;
+    TokenManager* tokens_ = nullptr;
     
     // Heartbeat timer
     std::shared_ptr<boost::asio::steady_timer> heartbeatTimer_;